@@ -0,0 +1,116 @@
+/************************************************************************************
+ MsfDiversity, combines several MsfTimeLib receivers into one time
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#include <MsfDiversity.h>
+
+#if MSF_VOTE_DEPTH
+MsfDiversity::MsfDiversity()
+{
+	numRx = 0;
+	minuteStart = 0;
+	announced = false;
+	TimeAvailable = 0;
+	Confidence = 0;
+	memset(rtcBuffer, 0, sizeof(rtcBuffer));
+	Bst = BstSoon = false;
+	TimeTime = 0;
+	Best = Receivers = 0;
+}
+
+bool MsfDiversity::add(MsfTimeLib &_rx)
+{
+	if(numRx >= MSF_DIVERSITY_MAX) return false;
+	rx[numRx] = &_rx;
+	generation[numRx] = _rx.softGeneration;
+	numRx++;
+	return true;
+}
+
+uint8_t MsfDiversity::update(void)
+{
+// Each receiver counts its minutes in softGeneration. When one has started a new minute the finished
+// minutes of all receivers whose minute started at the same time (within MSF_DIVERSITY_ALIGN) go to
+// one vote. The receivers start their minutes at slightly different edges so the first receiver to
+// start one is voted on alone and the vote is made again as the others follow. The interrupts write
+// the frames: a combination made while a receiver started a minute is thrown away and made again
+// at the next call.
+
+	uint8_t gen[MSF_DIVERSITY_MAX], newest[MSF_DIVERSITY_MAX], minutes[MSF_DIVERSITY_MAX];
+	uint32_t start[MSF_DIVERSITY_MAX];
+	bool fresh = false, timed = false;
+	uint32_t latest = 0;
+	for(uint8_t r = 0; r < numRx; r++)
+	{
+		MsfTimeLib &x = *rx[r];
+		noInterrupts();
+		gen[r] = x.softGeneration;
+		int8_t second = x.softSecond;
+		start[r] = x.softSecondStart - second * 1000000UL;
+		newest[r] = x.softNewest;
+		minutes[r] = second < 0 ? 0 : x.softMinutes;
+		interrupts();
+		if(gen[r] != generation[r]) fresh = true;
+		if(second < 0) continue;
+		// the minute that started last, a receiver that has just found the minute start has no
+		// minutes to add yet but still moves the minute on
+		if(!timed || (int32_t)(start[r] - latest) > 0) latest = start[r];
+		timed = true;
+	}
+	if(!fresh) return 0;
+	for(uint8_t r = 0; r < numRx; r++) generation[r] = gen[r];
+	// never go back to a minute before the last one combined
+	if(!timed || (int32_t)(latest - minuteStart) < -MSF_DIVERSITY_ALIGN) return 0;
+
+	const MsfSoftFrame * frame[MSF_DIVERSITY_MAX * MSF_VOTE_DEPTH];
+	uint8_t age[MSF_DIVERSITY_MAX * MSF_VOTE_DEPTH];
+	uint8_t count = 0, used = 0, best = 0, bestConfidence = 0;
+	for(uint8_t r = 0; r < numRx; r++)
+	{
+		if(!minutes[r] || labs((int32_t)(start[r] - latest)) > MSF_DIVERSITY_ALIGN) continue;
+		// softNewest is the minute being received, the last complete one is before it
+		for(uint8_t i = 0; i < minutes[r]; i++)
+		{
+			frame[count] = &rx[r]->softFrames[(newest[r] + MSF_VOTE_DEPTH - 1 - i) % MSF_VOTE_DEPTH];
+			age[count++] = i;
+		}
+		if(rx[r]->Confidence > bestConfidence)
+		{
+			bestConfidence = rx[r]->Confidence;
+			best = r;
+		}
+		used++;
+	}
+	if(!count) return 0;
+	uint8_t rtc[7];
+	bool bst, bstSoon;
+	uint8_t confidence = MsfTimeLib::vote(frame, age, count, rtc, bst, bstSoon);
+	for(uint8_t r = 0; r < numRx; r++)
+	{
+		if(rx[r]->softGeneration != gen[r]) return 0;	// changed under the vote, made again next time
+	}
+
+	if((int32_t)(latest - minuteStart) > MSF_DIVERSITY_ALIGN)
+	{
+		// the first combination of a new minute
+		minuteStart = latest;
+		Confidence = 0;
+		announced = false;
+	}
+	if(confidence < Confidence) return confidence;
+	Confidence = confidence;
+	Receivers = used;
+	Best = best;
+	if(confidence < MSF_VOTE_MIN_CONFIDENCE) return confidence;
+	for(uint8_t x = 0; x < 7; x++) rtcBuffer[x] = rtc[x];
+	TimeTime = MsfTimeLib::toTimeT(rtc);
+	Bst = bst;
+	BstSoon = bstSoon;
+	if(!announced) TimeAvailable = 1;
+	announced = true;
+	return confidence;
+}
+#endif
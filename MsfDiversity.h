@@ -0,0 +1,69 @@
+/************************************************************************************
+ MsfDiversity, combines several MsfTimeLib receivers into one time
+
+ Two or more receivers (antennas at different orientations or places) fade at
+ different times. Each decoder runs on its own interrupt with the voting decoder on
+ (voteDecode(true)) and MsfDiversity adds up the soft bits of the minutes every
+ receiver has heard, so a bit lost by one receiver is filled in by another and a
+ bit heard by both counts twice. Call update() from loop():
+
+	MsfTimeLib rx1, rx2;
+	MsfDiversity diversity;
+
+	rx1.begin(0, MSF_PAD_10MS);
+	rx2.begin(1, MSF_PAD_10MS);
+	rx1.voteDecode(true);
+	rx2.voteDecode(true);
+	diversity.add(rx1);
+	diversity.add(rx2);
+	...
+	diversity.update();
+	if(diversity.TimeAvailable) ...
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#ifndef MsfDiversity_h
+#define MsfDiversity_h
+
+#include <MsfTimeLib.h>
+
+// the largest number of receivers that can be combined
+#define MSF_DIVERSITY_MAX 	4
+
+// receivers whose minutes start further apart than this (us) are not combined
+#define MSF_DIVERSITY_ALIGN 500000L
+
+#if MSF_VOTE_DEPTH
+class MsfDiversity
+{
+	private:
+		MsfTimeLib * rx[MSF_DIVERSITY_MAX];		// the receivers
+		uint8_t generation[MSF_DIVERSITY_MAX];	// softGeneration of each receiver at the last combination
+		uint8_t numRx;							// the number of receivers added
+		uint32_t minuteStart;					// us of the start of the minute last combined
+		bool announced;							// TimeAvailable has been set for that minute
+
+	public:
+		MsfDiversity();
+
+		// add a receiver, false when MSF_DIVERSITY_MAX have been added already
+		bool add(MsfTimeLib &_rx);
+		// combine the receivers if one has started a new minute, returns the Confidence of the new
+		// combination or 0 if there was none. Call from loop(), never from an interrupt
+		uint8_t update(void);
+
+		// the same as in MsfTimeLib, for the combined receivers
+		int8_t TimeAvailable;				// set to 1 when a new minute has been combined with Confidence >= MSF_VOTE_MIN_CONFIDENCE
+		uint8_t Confidence;					// 0 - 100, how sure the combination is of the time
+		uint8_t rtcBuffer[7];				// BCD buffer for RTC clock bytes
+		bool Bst;							// 1 = BST, 0 = GMT
+		bool BstSoon;						// 1 = BST imminent
+		time_t TimeTime;					// time_t of the start of the minute
+		uint8_t Best;						// the receiver (order of add()) with the highest Confidence of its own
+		uint8_t Receivers;					// the number of receivers in the last combination
+};
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+/************************************************************************************
+ MsfDutyCycle, powers an MSF receiver only while it is needed
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#include <MsfDutyCycle.h>
+
+#if (MSF_FEATURES & (MSF_FEATURE_PON | MSF_FEATURE_HOLD | MSF_FEATURE_FIX)) == (MSF_FEATURE_PON | MSF_FEATURE_HOLD | MSF_FEATURE_FIX)
+MsfDutyCycle::MsfDutyCycle()
+{
+	rx = NULL;
+	state = MSF_DUTY_ON;
+	wakeTime = 0;
+	OnSeconds = 0;
+	Wakeups = Fixes = Failures = 0;
+	LastOnSeconds = LastSettleSeconds = 0;
+	LastAttempts = 0;
+}
+
+bool MsfDutyCycle::begin(MsfTimeLib &_rx, uint32_t _budgetMs, uint8_t _attempts)
+{
+	if(!_rx.ponPin) return false;
+	rx = &_rx;
+	budgetUs = _budgetMs * 1000UL;
+	attempts = _attempts ? _attempts : 1;
+	MsfFix fix;
+	_rx.getFix(fix);
+	generation = fix.generation;
+	fixTime = 0;
+	wakeTime = 0;
+	onCount = 0;
+	countMillis = millis();
+	power(MSF_DUTY_ON);						// on until the first fix
+	return true;
+}
+
+void MsfDutyCycle::power(uint8_t _state)
+{
+	uint32_t ms = millis();
+	state = _state;
+	rx->rxOn(_state == MSF_DUTY_ON ? LOW : HIGH);	// PON LOW = receiver ON, the decoder starts again
+	if(_state == MSF_DUTY_ON)
+	{
+		onMillis = tryMillis = ms;
+		onSeconds = rx->NumSeconds;
+		settled = false;
+		Wakeups++;
+	}
+	else
+	{
+		LastOnSeconds = (ms - onMillis) / 1000;
+		// the minutes that could have given a fix after the warm up
+		LastAttempts = LastOnSeconds > MSF_DUTY_WARMUP ? (LastOnSeconds - MSF_DUTY_WARMUP + 59) / 60 : 0;
+	}
+}
+
+void MsfDutyCycle::plan(void)
+{
+// Everything here is in UTC (nowUtc()) so a BST change does not move a wake up by an hour.
+// After a fix nowUtc() is out by nowUncertaintyMicros() and that grows by driftUncertaintyPpb() every
+// second. The receiver is woken in time to decode the last minute that ends before the error reaches
+// the budget: the fix comes at the end of a minute so that minute starts 60s earlier. The oscillator
+// has to be measured first, which needs a second fix MSF_HOLD_MIN_SPAN after the first. The wait is
+// never longer than MSF_HOLD_SPAN so the measurement follows temperature changes. A wake up due
+// within a minute or so leaves the receiver on (wakeTime = 0).
+
+	time_t now = rx->nowUtc();
+	uint32_t uncertainty = rx->nowUncertaintyMicros();
+	uint32_t ppb = rx->driftUncertaintyPpb();
+	uint32_t hold;
+	if(ppb == 0xFFFFFFFFUL) hold = MSF_HOLD_MIN_SPAN;
+	else if(uncertainty >= budgetUs) hold = 0;
+	else hold = (uint64_t)(budgetUs - uncertainty) * 1000ULL / (ppb ? ppb : 1);
+	if(hold > MSF_HOLD_SPAN) hold = MSF_HOLD_SPAN;
+	time_t deadline = now + hold;
+	time_t minute = deadline - deadline % 60 - 60;	// the start of the minute to decode
+	wakeTime = minute - MSF_DUTY_WARMUP;
+	if(wakeTime <= now + MSF_DUTY_WARMUP) wakeTime = 0;
+}
+
+uint8_t MsfDutyCycle::update(void)
+{
+	if(!rx) return MSF_DUTY_ON;
+	uint32_t ms = millis();
+	if(state == MSF_DUTY_ON)
+	{
+		onCount += ms - countMillis;
+		OnSeconds += onCount / 1000;
+		onCount %= 1000;
+	}
+	countMillis = ms;
+	time_t now = rx->nowUtc();				// UTC, also keeps the holdover clock going while the receiver is off
+	if(state == MSF_DUTY_OFF)
+	{
+		if(wakeTime ? now >= wakeTime : (int32_t)(ms - wakeMillis) >= 0) power(MSF_DUTY_ON);
+		return state;
+	}
+
+	if(!settled && rx->NumSeconds != onSeconds)
+	{
+		settled = true;
+		LastSettleSeconds = (ms - onMillis) / 1000;
+	}
+	MsfFix fix;
+	if(rx->getFix(fix) && fix.generation != generation)
+	{
+		generation = fix.generation;
+		// the receiver only goes off on a fix that is as far after the last one as millis() says,
+		// within MSF_HOLD_MAX_PPM and a second for the time the fix waited for update(), in UTC so
+		// the fix after a BST change still agrees
+		time_t utc = fix.bst ? fix.time - 3600 : fix.time;
+		int64_t late = ((int64_t)utc - fixTime) * 1000 - (uint32_t)(ms - fixMillis);
+		uint32_t slack = 1000 + (uint32_t)(ms - fixMillis) / 1000 * MSF_HOLD_MAX_PPM / 1000;
+		bool confirmed = fixTime && (late < 0 ? -late : late) <= slack;
+		fixTime = utc;
+		fixMillis = ms;
+		wakeTime = 0;
+		if(confirmed) plan();
+		if(wakeTime)
+		{
+			Fixes++;						// once per wake up, when the fix that ends it is confirmed
+			power(MSF_DUTY_OFF);
+		}
+		else tryMillis = ms;				// stays on for the next fix, the attempts start again
+		return state;
+	}
+	if(ms - tryMillis >= (MSF_DUTY_WARMUP + attempts * 60UL + 5) * 1000UL)
+	{
+		// no fix, try again later on a minute boundary if the time is known
+		Failures++;
+		if(now)
+		{
+			time_t next = now + MSF_DUTY_RETRY + 60;
+			wakeTime = next - next % 60 - MSF_DUTY_WARMUP;
+		}
+		else
+		{
+			wakeTime = 0;
+			wakeMillis = ms + MSF_DUTY_RETRY * 1000UL;
+		}
+		power(MSF_DUTY_OFF);
+	}
+	return state;
+}
+
+time_t MsfDutyCycle::nextWake(void)
+{
+	return state == MSF_DUTY_OFF ? wakeTime : 0;
+}
+#endif
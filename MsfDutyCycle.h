@@ -0,0 +1,87 @@
+/************************************************************************************
+ MsfDutyCycle, powers an MSF receiver only while it is needed
+
+ A battery powered clock needs one good minute every few hours, not a receiver that
+ is on all the time. MsfDutyCycle turns the receiver on through the PON pin given to
+ begin() a little before a minute starts, keeps it on until a fix (or a number of
+ minutes without one) and turns it off again. The next wake up is worked out in UTC
+ from the holdover clock (nowUtc()): the receiver is woken in time for the fix that
+ keeps nowUncertaintyMicros() inside the accuracy asked for. A fix has to agree with
+ the one before it (by millis()) before the receiver is turned off, so a wrong minute
+ is not kept for hours. Call update() from loop():
+
+	MsfDutyCycle duty;
+
+	msf.begin(0, MSF_PAD_10MS, MSF_PULSE_HIGH, PON_PIN);
+	duty.begin(msf, 100);			// keep msf.nowUtc() within 100ms
+	...
+	duty.update();
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#ifndef MsfDutyCycle_h
+#define MsfDutyCycle_h
+
+#include <MsfTimeLib.h>
+
+// seconds the receiver is on before the minute it should decode (the receiver AGC settles), the
+// minutes it stays on without a fix, and the seconds it stays off after that before it tries again
+#define MSF_DUTY_WARMUP 	10
+#define MSF_DUTY_ATTEMPTS 	5
+#define MSF_DUTY_RETRY 		900UL
+
+// update() returns the receiver state
+#define MSF_DUTY_OFF 		0
+#define MSF_DUTY_ON 		1
+
+// needs the PON pin, the holdover clock and getFix()
+#if (MSF_FEATURES & (MSF_FEATURE_PON | MSF_FEATURE_HOLD | MSF_FEATURE_FIX)) == (MSF_FEATURE_PON | MSF_FEATURE_HOLD | MSF_FEATURE_FIX)
+class MsfDutyCycle
+{
+	private:
+		MsfTimeLib * rx;					// the receiver, NULL = not started
+		uint32_t budgetUs;					// the largest nowUtc() error allowed in us
+		uint8_t attempts;					// minutes without a fix before the receiver is turned off
+		uint8_t state;						// MSF_DUTY_ON or MSF_DUTY_OFF
+		time_t wakeTime;					// the UTC time to turn the receiver on, 0 = at wakeMillis
+		uint32_t wakeMillis;				// millis() to turn it on when there is no time yet
+		uint32_t onMillis;					// millis() when it was turned on
+		uint32_t tryMillis;					// millis() when the attempts for a fix started
+		uint32_t countMillis;				// millis() up to which OnSeconds has been counted
+		uint32_t onCount;					// ms on not yet counted in OnSeconds
+		uint32_t generation;				// the last fix seen
+		time_t fixTime;						// the UTC time of that fix, 0 = none yet
+		uint32_t fixMillis;					// and millis() when it was seen
+		uint8_t onSeconds;					// NumSeconds when the receiver was turned on
+		bool settled;						// a second has been received since the receiver was turned on
+
+		// Function to turn the receiver on or off
+		void power(uint8_t _state);
+		// Function to work out when to wake up after a fix
+		void plan(void);
+
+	public:
+		MsfDutyCycle();
+
+		// start duty cycling _rx (begin() must have been given a PON pin), keeping nowUtc() within
+		// _budgetMs ms and trying _attempts minutes for a fix. false if _rx has no PON pin
+		bool begin(MsfTimeLib &_rx, uint32_t _budgetMs, uint8_t _attempts = MSF_DUTY_ATTEMPTS);
+		// turn the receiver on and off, call from loop() at least once a second
+		uint8_t update(void);
+		// the UTC time of the next wake up, 0 = not known (there is no time yet or the receiver is on)
+		time_t nextWake(void);
+
+		// what the receiver has cost
+		uint32_t OnSeconds;					// total seconds on
+		uint16_t Wakeups;					// times turned on
+		uint16_t Fixes;						// wake ups that ended with a confirmed fix
+		uint16_t Failures;					// wake ups that ended without one
+		uint16_t LastOnSeconds;				// seconds on in the last wake up
+		uint16_t LastSettleSeconds;			// seconds from power on to the first second received in the last wake up
+		uint8_t LastAttempts;				// minute starts seen in the last wake up
+};
+#endif
+
+#endif
@@ -0,0 +1,253 @@
+/************************************************************************************
+ MsfSignalGen, an MSF signal generator for MsfTimeLib
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#include <MsfSignalGen.h>
+
+// bit positions of the fields in the A/B frames of a 60 second minute
+#define GEN_YEAR_POS 		17
+#define GEN_MARKER_POS 		52
+#define GEN_PARITY_POS 		54
+#define GEN_BSTSOON_POS 	53
+#define GEN_BST_POS 		58
+#define GEN_DUTPOS_POS 		1
+#define GEN_DUTNEG_POS 		9
+#define GEN_LEAP_POS 		16		// the bit that is removed or repeated in a leap second minute
+
+static void genSetBit(uint8_t * _frame, uint8_t _pos, bool _val)
+{
+	// bits are numbered from the MSB (0) of the first Byte as in the decoder buffers
+	bitWrite(_frame[_pos / 8], (_pos % 8) ^ 0x07, _val);
+}
+
+static bool genGetBit(uint8_t * _frame, uint8_t _pos)
+{
+	return bitRead(_frame[_pos / 8], (_pos % 8) ^ 0x07);
+}
+
+MsfSignalGen::MsfSignalGen()
+{
+	memset(&noise, 0, sizeof(noise));
+	seed = 1;
+	dut1 = 0;
+	leapSecond = 0;
+	bst = false;
+	bstSoon = false;
+	bstChange = 0;
+}
+
+void MsfSignalGen::begin(time_t _time, uint32_t _ms, uint8_t _carrierOff)
+{
+	minuteStart = _time - (_time % 60);
+	secondMs = _ms;
+	lastMs = _ms - 1;
+	carrierOff = _carrierOff;
+	level = !carrierOff;				// the carrier is ON before the first pulse
+	second = 0;
+	secondsInMinute = 60;
+	fadeLeft = 0;
+	numToggles = nextToggle = 0;
+}
+
+void MsfSignalGen::setNoise(const MsfNoise &_noise)
+{
+	noise = _noise;
+}
+
+void MsfSignalGen::setSeed(uint32_t _seed)
+{
+	seed = _seed ? _seed : 1;			// xorshift must never be 0
+}
+
+void MsfSignalGen::setDut1(int8_t _dut1)
+{
+	dut1 = constrain(_dut1, -8, 8);
+}
+
+void MsfSignalGen::setBst(bool _bst, bool _bstSoon)
+{
+	bst = _bst;
+	bstSoon = _bstSoon;
+}
+
+void MsfSignalGen::setBstChange(time_t _utc)
+{
+	bstChange = _utc;
+}
+
+void MsfSignalGen::setLeapSecond(int8_t _leap)
+{
+	leapSecond = constrain(_leap, -1, 1);
+}
+
+time_t MsfSignalGen::minuteTime(void)
+{
+	return minuteStart;
+}
+
+uint32_t MsfSignalGen::minuteStartMs(void)
+{
+	return minuteMs;
+}
+
+void MsfSignalGen::nextEdge(uint32_t &_ms, uint8_t &_level)
+{
+	// a missing second has no edges so keep going until there is one
+	while(nextToggle >= numToggles) makeSecond();
+	uint32_t ms = secondMs - 1000 + toggles[nextToggle++];
+	// never go backwards in time, edges closer than 1ms come out 1ms apart
+	if((int32_t)(ms - lastMs) <= 0) ms = lastMs + 1;
+	lastMs = ms;
+	level = !level;
+	_ms = ms;
+	_level = level;
+}
+
+void MsfSignalGen::makeFrame(void)
+{
+	// the same encoding as the MSF_Signal_Simulator sketch. The minute being sent
+	// carries the time at the start of the following minute
+	frameTime = minuteStart + 60;
+	time_t utc = frameTime - (bst ? 3600 : 0);
+	bool soon = bstSoon;
+	if(bstChange && utc >= bstChange)
+	{
+		bst = !bst;
+		frameTime = utc + (bst ? 3600 : 0);
+		bstChange = 0;
+	}
+	else if(bstChange && utc >= bstChange - 61 * 60) soon = true;	// the 61 minutes before
+	uint8_t rtc[7] = {0};
+	MsfTimeLib::fromTimeT(frameTime, rtc);
+	uint8_t fields[6] = { rtc[MSF_YEAR], rtc[MSF_MONTH], rtc[MSF_DATE], rtc[MSF_DAY], rtc[MSF_HOUR], rtc[MSF_MINUTE] };
+	const uint8_t widths[6] = { 8, 5, 6, 3, 6, 7 };
+	const uint8_t parityBits[4] = { 8, 11, 3, 13 };		// year, month + date, weekday, hour + minute
+	memset(&aFrame[0], 0, sizeof(aFrame));
+	memset(&bFrame[0], 0, sizeof(bFrame));
+	uint8_t pos = GEN_YEAR_POS;
+	for(uint8_t f = 0; f < 6; f++)
+	{
+		for(int8_t i = widths[f] - 1; i >= 0; i--) genSetBit(aFrame, pos++, bitRead(fields[f], i));
+	}
+	for(uint8_t i = 0; i < 8; i++) genSetBit(aFrame, GEN_MARKER_POS + i, bitRead(MSF_MARKER, 7 - i));
+	// odd parity, the parity bit makes the number of "1"s odd
+	pos = GEN_YEAR_POS;
+	for(uint8_t p = 0; p < 4; p++)
+	{
+		uint8_t ones = 0;
+		for(uint8_t i = 0; i < parityBits[p]; i++) ones += genGetBit(aFrame, pos++);
+		genSetBit(bFrame, GEN_PARITY_POS + p, !(ones & 1));
+	}
+	genSetBit(bFrame, GEN_BSTSOON_POS, soon);
+	genSetBit(bFrame, GEN_BST_POS, bst);
+	frameLeap = leapSecond;
+	leapSecond = 0;
+	// UT1 does not stop for a leap second, DUT1 moves by it from the minute after (which this carries)
+	dut1 = constrain(dut1 + frameLeap * 10, -8, 8);
+	for(uint8_t i = 0; i < abs(dut1); i++) genSetBit(bFrame, (dut1 > 0 ? GEN_DUTPOS_POS : GEN_DUTNEG_POS) + i, 1);
+	secondsInMinute = 60 + frameLeap;
+}
+
+void MsfSignalGen::addToggle(int16_t _ms)
+{
+	if(numToggles < MSF_GEN_MAX_EDGES) toggles[numToggles++] = _ms;
+}
+
+void MsfSignalGen::addNoise(uint8_t _count)
+{
+	// an even number of random edges so the second ends with the carrier ON
+	uint8_t n = rand16(_count / 2 + 1) * 2;
+	for(uint8_t i = 0; i < n; i++) addToggle(rand16(1000));
+}
+
+void MsfSignalGen::makeSecond(void)
+{
+	if(second >= secondsInMinute)
+	{
+		second = 0;
+		minuteStart = frameTime;
+	}
+	if(!second)
+	{
+		minuteMs = secondMs;
+		makeFrame();
+	}
+	numToggles = nextToggle = 0;
+
+	if(fadeLeft || (noise.fade && chance(noise.fade)))
+	{
+		// fading: the receiver output is random
+		if(!fadeLeft) fadeLeft = noise.fadeSeconds;
+		if(fadeLeft) fadeLeft--;
+		addNoise(MSF_GEN_MAX_EDGES / 2);
+	}
+	else if(!noise.dropout || !chance(noise.dropout))
+	{
+		// the frame bit for this second, after the leap second bit the bits follow the end of the minute
+		uint8_t src = second;
+		if(second > GEN_LEAP_POS) src = second - frameLeap;
+		else if(second == GEN_LEAP_POS && frameLeap < 0) src = GEN_LEAP_POS + 1;
+		bool a = genGetBit(aFrame, src);
+		bool b = genGetBit(bFrame, src);
+		int16_t stretch = noise.stretchMs;
+		addToggle(0);										// carrier OFF at the start of every second
+		if(!second) addToggle(500 + stretch);				// minute START
+		else if(b && !a)
+		{
+			// 100ms off + 100ms on + 100ms off
+			addToggle(100 + stretch);
+			addToggle(200);
+			addToggle(300 + stretch);
+		}
+		else addToggle((a ? (b ? 300 : 200) : 100) + stretch);
+		if(noise.glitch && chance(noise.glitch))
+		{
+			uint8_t width = noise.glitchMs ? rand16(noise.glitchMs) + 1 : 1;
+			int16_t at = rand16(1000 - width);
+			addToggle(at);
+			addToggle(at + width);
+		}
+		if(noise.jitterMs)
+		{
+			for(uint8_t i = 0; i < numToggles; i++)
+			{
+				toggles[i] += (int16_t)rand16(noise.jitterMs * 2 + 1) - noise.jitterMs;
+			}
+		}
+	}
+
+	// keep the edges in time order (insertion sort, a handful of edges) and inside the second, but
+	// jitter may put the carrier OFF edge before its start (nextEdge() keeps it after the edge before)
+	// as clamping it to 0 would make every jittered second start late
+	for(uint8_t i = 0; i < numToggles; i++)
+	{
+		int16_t t = constrain(toggles[i], -500, 999);
+		int8_t j = i - 1;
+		while(j >= 0 && toggles[j] > t)
+		{
+			toggles[j + 1] = toggles[j];
+			j--;
+		}
+		toggles[j + 1] = t;
+	}
+
+	secondMs += 1000;
+	second++;
+}
+
+uint16_t MsfSignalGen::rand16(uint16_t _range)
+{
+	// xorshift32
+	seed ^= seed << 13;
+	seed ^= seed >> 17;
+	seed ^= seed << 5;
+	return _range ? (seed >> 8) % _range : 0;
+}
+
+bool MsfSignalGen::chance(uint16_t _perThousand)
+{
+	return rand16(1000) < _perThousand;
+}
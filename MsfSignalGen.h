@@ -0,0 +1,106 @@
+/************************************************************************************
+ MsfSignalGen, an MSF signal generator for MsfTimeLib
+
+ Produces the same A/B bit stream as the MSF_Signal_Simulator sketch (DUT1, BST,
+ BST imminent, parity and leap seconds) as a stream of edge timestamps instead of
+ driving a pin in real time. nextEdge() returns the edges as fast as they are asked
+ for so the decoder can be tested and benchmarked on millions of minutes, either
+ on a board or on a host (see extras/host).
+
+ Receiver and radio impairments can be added to the clean signal with MsfNoise:
+ timing jitter, pulse stretching, missing seconds, spurious short pulses and fades.
+ The noise uses its own random generator so a given seed always produces the same
+ stream.
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#ifndef MsfSignalGen_h
+#define MsfSignalGen_h
+
+#include <MsfTimeLib.h>
+
+// the maximum number of edges generated for one second
+#define MSF_GEN_MAX_EDGES 	16
+
+// receiver/radio impairments, all chances are per second in units of 1/1000
+struct MsfNoise
+{
+	uint16_t jitterMs;		// every edge is moved by a random amount of up to +/- jitterMs
+	int16_t stretchMs;		// carrier OFF pulses are lengthened (negative = shortened) by stretchMs
+	uint16_t dropout;		// chance that a second has no pulse at all (carrier stays ON)
+	uint16_t glitch;		// chance of a spurious pulse somewhere in the second
+	uint8_t glitchMs;		// maximum width of a spurious pulse in ms
+	uint16_t fade;			// chance that a fade starts
+	uint8_t fadeSeconds;	// length of a fade in seconds, the output is random during a fade
+};
+
+class MsfSignalGen
+{
+	private:
+		uint8_t aFrame[8];					// 'A' bits of the minute being sent, bit 0 = MSB of aFrame[0]
+		uint8_t bFrame[8];					// 'B' bits of the minute being sent
+		int16_t toggles[MSF_GEN_MAX_EDGES];	// edge times of the current second in ms from its start (jitter may make the first negative)
+		uint8_t numToggles;					// number of edges in toggles[]
+		uint8_t nextToggle;					// next edge to be returned by nextEdge()
+		uint32_t secondMs;					// ms of the start of the current second
+		uint32_t minuteMs;					// ms of the start of the minute being sent
+		uint32_t lastMs;					// ms of the last edge returned
+		time_t minuteStart;					// time of the minute being sent
+		time_t frameTime;					// time the minute being sent carries (that of the next)
+		uint8_t second;						// second within the minute being sent
+		uint8_t secondsInMinute;			// 60, or 59/61 for a leap second minute
+		uint8_t level;						// current output level
+		uint8_t carrierOff;					// output level when the carrier is OFF
+		int8_t dut1;						// DUT1 in units of 100ms
+		int8_t leapSecond;					// leap second for the next minute (-1, 0 or 1)
+		int8_t frameLeap;					// leap second in the minute being sent
+		bool bst;							// BST flag sent
+		bool bstSoon;						// BST imminent flag sent
+		time_t bstChange;					// UTC at which the BST flag turns over, 0 = never
+		uint8_t fadeLeft;					// seconds of fade still to come
+		uint32_t seed;						// random generator state
+		MsfNoise noise;						// the impairments
+
+		// Function to build the A/B frames for the minute starting at minuteStart
+		void makeFrame(void);
+		// Function to build the edges of the next second
+		void makeSecond(void);
+		// Function to add a random number (_count / 2) of random edges for a fade
+		void addNoise(uint8_t _count);
+		// Function to add an edge to toggles[]
+		void addToggle(int16_t _ms);
+		// random number 0 to _range - 1
+		uint16_t rand16(uint16_t _range);
+		// true with a chance of _perThousand / 1000
+		bool chance(uint16_t _perThousand);
+
+	public:
+		MsfSignalGen();
+
+		// start generating: the minute of time _time (2000 to 2099) starts (500ms START pulse) at _ms
+		void begin(time_t _time, uint32_t _ms, uint8_t _carrierOff = MSF_PULSE_HIGH);
+		// set the impairments, a zeroed MsfNoise gives a clean signal
+		void setNoise(const MsfNoise &_noise);
+		// set the random generator seed (must not be 0)
+		void setSeed(uint32_t _seed);
+		// DUT1 in units of 100ms, -8 to +8
+		void setDut1(int8_t _dut1);
+		// BST and BST imminent flags
+		void setBst(bool _bst, bool _bstSoon);
+		// BST starts or ends at UTC _utc (0 = never): the BST flag turns over, the time sent moves by
+		// an hour and BST imminent is sent for the 61 minutes before
+		void setBstChange(time_t _utc);
+		// add (1) or remove (-1) a second in the next minute that starts, DUT1 moves by it from the time it carries
+		void setLeapSecond(int8_t _leap);
+
+		// get the next edge: its time in ms and the new output level
+		void nextEdge(uint32_t &_ms, uint8_t &_level);
+		// the time of the minute being sent (the decoder announces minuteTime() + 60 at its end)
+		time_t minuteTime(void);
+		// the ms of the start of the minute being sent
+		uint32_t minuteStartMs(void);
+};
+
+#endif
@@ -11,9 +11,50 @@
 
 #include <MsfTimeLib.h>
 
-MsfTimeLib *MSFs = NULL;
-
-MsfTimeLib::MsfTimeLib() {}
+MsfTimeLib::MsfTimeLib()
+{
+	// the optional parts start off, with the defaults their setters give
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+	deferred = false;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_CLOCK
+	timeSource = micros;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_FIX
+	minuteCallback = NULL;
+	fixSequence = 0;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+	secondCallback = NULL;
+	errorCallback = NULL;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+	glitchUs = MSF_GLITCH_MS * 1000UL;
+#endif
+#if MSF_VOTE_DEPTH
+	voting = false;
+#endif
+#if MSF_REPAIR_GROUPS
+	repairing = false;
+#endif
+#if MSF_TRACK_RUN
+	tracking = false;
+#endif
+	// the fields of the last minute read as nothing received until the first one, also for a
+	// decoder that is not a global (a global is cleared anyway)
+	memset((void *)rtcBuffer, 0, sizeof(rtcBuffer));
+	TimeTime = 0;
+	ParityResult = 0;
+	LeapSecond = 0;
+	RxSecs = 0;
+	startOfSecond = false;
+#if MSF_FEATURES & MSF_FEATURE_BST
+	Bst = BstSoon = false;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_DUT
+	DutPos = DutNeg = 0;
+#endif
+}
 
 // AVR & ESP8266 interrupt pin assignment examples
 /*
@@ -28,24 +69,245 @@ All digital pin numbers are the Arduino "Dx" pin numbers.
 */
 
 #if MSF_BOARD_ID == 1	// UNO, NANO etc.
-	static int8_t interuptPins[MSF_INT_PINS] = {2,3};
+	static int8_t interruptPins[MSF_INT_PINS] = {2,3};
 #elif MSF_BOARD_ID == 2	// MEGA2560 etc.
 	static int8_t interruptPins[MSF_INT_PINS] = {2,3,21,20,19,18};
 #elif MSF_BOARD_ID == 3	// ATmega1284 AVR etc.
 	static int8_t interruptPins[MSF_INT_PINS] = {10,11,3};
 #elif MSF_BOARD_ID == 4	// ESP8266 (available interrupt pins are device specific)
 	static int8_t interruptPins[MSF_INT_PINS] = {0,1,2,3,4,5,-1,-1,-1,-1,-1,-1,12,13,14,15,-1};
+#elif MSF_BOARD_ID == 5	// host build, behaves like an UNO
+	static int8_t interruptPins[MSF_INT_PINS] = {2,3};
 #else
 	static int8_t interruptPins[MSF_INT_PINS] = {};
 #endif
 
-void msfIntChange() 	// static function for the interrupt handler
+#define SECS_PER_MIN  (60UL)
+#define SECS_PER_HOUR (3600UL)
+#define SECS_PER_DAY  (SECS_PER_HOUR * 24UL)
+#define DAYS_TO_2000  10957U		// days from 1/1/1970 to 1/1/2000
+#define DAYS_PER_4_YEARS 1461U		// days in 4 years including one leap year
+
+// shift a new bit into an 'A' or 'B' register
+static inline void bitsPush(MsfBits &_bits, uint8_t _bit)
+{
+#if defined(__AVR__)
+	_bits.hi = (_bits.hi << 1) | (_bits.lo >> 31);
+	_bits.lo = (_bits.lo << 1) | _bit;
+#else
+	_bits = (_bits << 1) | _bit;
+#endif
+}
+
+// return bit _n of an 'A' or 'B' register, the bit received _n seconds ago
+static inline uint8_t bitsGet(const MsfBits &_bits, uint8_t _n)
+{
+#if defined(__AVR__)
+	return (_n < 32 ? _bits.lo >> _n : _bits.hi >> (_n - 32)) & 1;
+#else
+	return (_bits >> _n) & 1;
+#endif
+}
+
+// return the last 8 bits of an 'A' or 'B' register
+static inline uint8_t bitsLow8(const MsfBits &_bits)
+{
+#if defined(__AVR__)
+	return (uint8_t)_bits.lo;
+#else
+	return (uint8_t)_bits;
+#endif
+}
+
+// overwrite the last bit of an 'A' or 'B' register
+static inline void bitsReplace(MsfBits &_bits, uint8_t _bit)
+{
+#if defined(__AVR__)
+	_bits.lo = (_bits.lo & ~1UL) | _bit;
+#else
+	_bits = (_bits & ~(MsfBits)1) | _bit;
+#endif
+}
+
+#if MSF_VOTE_DEPTH
+// the positions of the fields in the 'A' bits of an MsfSoftFrame
+#define SOFT_YEAR 		0
+#define SOFT_MONTH 		8
+#define SOFT_WEEKDAY 	19
+#define SOFT_HOUR 		22
+#define SOFT_MINUTE 	28
+#define SOFT_SUMS 		28			// the bits added up over the minutes: year to hour
+
+// ms of carrier OFF from _from to _to us inside the window starting at _window ms
+static inline uint8_t softOverlap(int32_t _from, int32_t _to, int16_t _window)
+{
+	int32_t start = _window * 1000L;
+	int32_t end = (_window + MSF_SOFT_WINDOW_LEN) * 1000L;
+	if(_from < start) _from = start;
+	if(_to > end) _to = end;
+	return _to > _from ? (_to - _from + 500) / 1000 : 0;
+}
+
+// the soft bit from the ms of carrier OFF in a window, -100 to +100
+static inline int8_t softBit(uint8_t _offMs)
+{
+	if(_offMs > MSF_SOFT_WINDOW_LEN) _offMs = MSF_SOFT_WINDOW_LEN;
+	return (int16_t)_offMs * 200 / MSF_SOFT_WINDOW_LEN - 100;
+}
+
+// the next minute in BCD, 0x59 is followed by 0x00
+static inline uint8_t bcdNextMinute(uint8_t _bcd)
+{
+	if(_bcd == 0x59) return 0;
+	return (_bcd & 0x0F) == 9 ? (_bcd & 0xF0) + 0x10 : _bcd + 1;
+}
+
+// how well the soft bits match _bits (_num bits, MSB first)
+static int16_t softMatch(const int8_t * _soft, uint8_t _bits, uint8_t _num)
+{
+	int16_t score = 0;
+	for(uint8_t j = 0; j < _num; j++) score += bitRead(_bits, _num - 1 - j) ? _soft[j] : -_soft[j];
+	return score;
+}
+
+// the bits (MSB first) of a group with odd parity from the added up soft bits. If the parity is
+// wrong the least certain bit, data or parity, is flipped. _margin is lowered to how much worse
+// the next best choice of bits would match
+static uint16_t softGroup(const int16_t * _sum, uint8_t _num, int16_t _parity, int16_t &_margin)
+{
+	uint16_t bits = 0;
+	uint8_t ones = _parity > 0;
+	int16_t min1 = abs(_parity), min2 = 0x7FFF;
+	int8_t minBit = -1;						// -1 = the parity bit
+	for(uint8_t j = 0; j < _num; j++)
+	{
+		int16_t s = abs(_sum[j]);
+		bits = (bits << 1) | (_sum[j] > 0);
+		ones += _sum[j] > 0;
+		if(s < min1)
+		{
+			min2 = min1;
+			min1 = s;
+			minBit = j;
+		}
+		else if(s < min2) min2 = s;
+	}
+	int16_t margin;
+	if(ones & 0x01) margin = 2 * (min1 + min2);
+	else
+	{
+		if(minBit >= 0) bits ^= 1 << (_num - 1 - minBit);
+		margin = 2 * (min2 - min1);
+	}
+	if(margin < _margin) _margin = margin;
+	return bits;
+}
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_PLL
+// the PLL error estimate: for each gear the standard deviation of the phase and of the period,
+// as a fraction * 256 of the standard deviation of the edges (alpha-beta filter with alpha = 1/2^gear,
+// beta = 1/2^(2 * gear + 1))
+static const uint8_t pllPhaseK[8] PROGMEM = {160, 111, 78, 55, 39, 28, 20, 14};
+static const uint8_t pllPeriodK[8] PROGMEM = {38, 12, 4, 2, 1, 1, 1, 1};
+#endif
+
+#if MSF_REPAIR_GROUPS
+// the parity groups: the offset of the first 'A' bit, the number of 'A' bits and the 'B' parity bit
+static const uint8_t repairGroups[4][3] PROGMEM = {
+	{MSF_YEAR_OFFSET, MSF_YEAR_PARITY_BITS, MSF_YEAR_PARITY_BIT_POS},
+	{MSF_MONTH_OFFSET, MSF_MONTH_PARITY_BITS, MSF_MONTH_PARITY_BIT_POS},
+	{MSF_WEEKDAY_OFFSET, MSF_WEEKDAY_PARITY_BITS, MSF_WEEKDAY_PARITY_BIT_POS},
+	{MSF_HOUR_OFFSET, MSF_HOUR_PARITY_BITS, MSF_HOUR_PARITY_BIT_POS}};
+
+// true if _bcd has BCD digits and is _min to _max (BCD)
+static inline bool bcdValid(uint8_t _bcd, uint8_t _min, uint8_t _max)
+{
+	return (_bcd & 0x0F) <= 9 && _bcd >= _min && _bcd <= _max;
+}
+
+// true if the bits of parity group _group (as in repairGroups) can be sent
+static bool repairValid(uint8_t _group, uint16_t _bits)
+{
+	switch(_group)
+	{
+		case 0:	return bcdValid(_bits, 0x00, 0x99);			// year
+		case 1: return bcdValid(_bits >> MSF_DATE_BITS, 0x01, 0x12) && bcdValid(_bits & 0x3F, 0x01, 0x31);	// month, date
+		case 2: return _bits <= 6;							// weekday
+		default: return bcdValid(_bits >> MSF_MINUTE_BITS, 0x00, 0x23) && bcdValid(_bits & 0x7F, 0x00, 0x59);	// hour, minute
+	}
+}
+#endif
+
+#if MSF_TRACK_RUN
+// trackBits of a START pulse
+#define MSF_TRACK_START 	0x04
+
+// the widths of the fields in the 'A' bits from second 17: year, month, date, weekday, hour, minute, marker
+static const uint8_t trackWidths[7] PROGMEM = {MSF_YEAR_BITS, MSF_MONTH_BITS, MSF_DATE_BITS, MSF_WEEKDAY_BITS,
+	MSF_HOUR_BITS, MSF_MINUTE_BITS, MSF_MARKER_BITS};
+#endif
+
+#if MSF_SAMPLED
+// the sampled front end pulse templates: the 100ms windows of the first 500ms of a second in which
+// the carrier is OFF (bit 0 = 0 - 100ms) for a 100, 200, 300ms, double 100ms ('B' only) and START pulse
+static const uint8_t sampleTemplates[5] PROGMEM = {0b00001, 0b00011, 0b00111, 0b00101, 0b11111};
+#endif
+
+// stops the compiler moving memory accesses across it, used for the getFix() sequence count
+#define MSF_BARRIER() __asm__ __volatile__("" ::: "memory")
+
+// the length of an MSF second in time source us, as the PLL has measured it
+#if MSF_FEATURES & MSF_FEATURE_PLL
+#define MSF_PERIOD_US 	(pllPeriod >> 8)
+#else
+#define MSF_PERIOD_US 	1000000UL
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_PLL
+// integer square root, of the PLL variance
+static uint16_t isqrt(uint32_t _x)
 {
-  if (MSFs) MSFs->msfPulse();
+	uint32_t root = 0, bit = 1UL << 30;
+	while(bit > _x) bit >>= 2;
+	while(bit)
+	{
+		if(_x >= root + bit)
+		{
+			_x -= root + bit;
+			root = (root >> 1) + bit;
+		}
+		else root >>= 1;
+		bit >>= 2;
+	}
+	return root;
 }
+#endif
+
+#if MSF_INT_PINS
+// the decoder attached to each interrupt number
+static MsfTimeLib *msfInstances[MSF_INT_PINS];
+
+// one interrupt handler per interrupt number, each calls its own decoder directly so any number
+// of receivers can run at once. get() picks the handler of an interrupt number at begin() time
+typedef void (*MsfIsr)(void);
+
+template<uint8_t N> struct MsfIsrTable
+{
+	static void handler(void) { msfInstances[N]->msfPulse(); }
+	static MsfIsr get(uint8_t _intNum) { return _intNum == N ? handler : MsfIsrTable<N - 1>::get(_intNum); }
+};
+
+template<> struct MsfIsrTable<0>
+{
+	static void handler(void) { msfInstances[0]->msfPulse(); }
+	static MsfIsr get(uint8_t) { return handler; }
+};
+#endif
 
 //     _intNum: 	Arduino Interrupt Number
 //    _padding:		In ms. If your MSF receiver gives pulses that are shorter
+//					MSF_PAD_AUTO measures the pulses and works out the padding itself
 // _carrierOff:		The actual output level from the receiver when the carrier is OFF (default HIGH)
 //     _ponPin:		The Arduino pin used to control the PON input on the MSF Receiver Module
 //     _ledPin: 	A Data pin to attach and flash an led on in time with incoming MSF signal(0 = no led)
@@ -67,31 +329,184 @@ int8_t MsfTimeLib::begin(uint8_t _intNum, int8_t _padding, uint8_t _carrierOff,
 
 int8_t MsfTimeLib::begin(uint8_t _intNum, int8_t _padding, uint8_t _carrierOff, int8_t _ponPin, int8_t _ledPin)
 {
-	// is the interrupt pin requested within available range?
-	if(_intNum > MSF_INT_PINS) return -1;
-	msfPin = interruptPins[_intNum];
-	// is the interrupt pin a valid interrupt pin?
-	if(msfPin == -1) return msfPin;
-	padding = _padding;
+	if(_intNum == MSF_NO_INTERRUPT) msfPin = MSF_NO_INTERRUPT;	// no pin, feedEdge() gives the edges
+	else
+	{
+		// is the interrupt pin requested within available range?
+		if(_intNum >= MSF_INT_PINS) return -1;
+		// is the interrupt pin a valid interrupt pin? (msfPin is unsigned so the table is tested)
+		if(interruptPins[_intNum] == -1) return -1;
+		msfPin = interruptPins[_intNum];
+	}
+	padding = _padding == MSF_PAD_AUTO ? 0 : _padding;
+#if MSF_AUTO_BINS
+	autoPad = _padding == MSF_PAD_AUTO;
+	memset(pulseHist, 0, sizeof(pulseHist));	// nothing measured yet
+	rxOffset = 0;
+	if(autoPad) pulseCalibrate();				// the nominal thresholds
+#endif
 	carrierOff = _carrierOff;
+#if MSF_FEATURES & MSF_FEATURE_PON
 	ponPin = _ponPin;
-	ledPin = _ledPin;
-	if(ledPin)	pinMode(ledPin, OUTPUT);	// set LED pin to OUTPUT if specified
 	if(ponPin)
 	{
 		pinMode(ponPin, OUTPUT);	// if pon_pin is > 0, set as OUTPUT
 		digitalWrite(ponPin, LOW);	// set pin LOW (PON ON)
 	}
-	memset(&aBuffer[0], 0xFF, sizeof(aBuffer));	// clear the "A" buffer to "1"s
-	memset(&bBuffer[0], 0, sizeof(bBuffer));	// clear the "B" buffer	to "0"s
-	MSFs = this; // singleton pointer
-	attachInterrupt(_intNum, msfIntChange, CHANGE);
+#else
+	(void)_ponPin;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_LED
+	ledPin = _ledPin;
+	if(ledPin)	pinMode(ledPin, OUTPUT);	// set LED pin to OUTPUT if specified
+#else
+	(void)_ledPin;
+#endif
+	memset(&aBits, 0xFF, sizeof(aBits));		// clear the "A" buffer to "1"s
+	memset(&bBits, 0, sizeof(bBits));			// clear the "B" buffer	to "0"s
+	memset(&parityBits, 0, sizeof(parityBits));	// clear the running parity
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+	ringHead = ringTail = 0;					// empty the deferred edge ring
+	EdgeOverflows = 0;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_HOLD
+	holdTime = baseTime = fixTime = 0;			// the holdover clock starts again
+	holdSeen = holdFixes;
+	leapStep = 0;
+	leapNow = false;
+	utcOffsetNow = 0;
+	utcChange = utcMonthEnd = 0;
+	utcDut = 0;
+	utcLast = 0;
+	holdPpb = 0;
+	holdPpbError = 0xFFFFFFFFUL;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_FIX
+	fixSequence++;								// no minute for getFix()
+	MSF_BARRIER();
+	memset(&fixBuffer, 0, sizeof(fixBuffer));
+	MSF_BARRIER();
+	fixSequence++;
+#endif
+#if MSF_VOTE_DEPTH
+	memset(softFrames, 0, sizeof(softFrames));	// no minutes to vote on
+	softNewest = softMinutes = 0;
+	softGeneration++;
+	softSecond = -1;
+	softOffA = softOffB = 0;
+#endif
+	Confidence = 0;
+	bitPointer = 0;								// forget any previous decoding
+	timeIsSet = false;
+	TimeAvailable = 0;
+	TimeReceived = 0;
+	NumSeconds = 0;
+	lastPulseStart = pulseStart = pulseEnd = markerStart = timeSource();
+	bitPushed = gapMerged = false;
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+	secondNumber = MSF_SECOND_UNKNOWN;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+	offStart = lastPulseStart;
+	spikeEnd = 0;
+	GlitchPulses = GlitchGaps = 0;
+#endif
+#if MSF_REPAIR_GROUPS
+	RepairedMinutes = 0;
+#endif
+#if MSF_TRACK_RUN
+	TrackedMinutes = 0;
+	trackTime = 0;								// nothing to track until a fix
+#endif
+#if MSF_FEATURES & MSF_FEATURE_PLL
+	pllPeriod = 1000000UL << 8;					// nominal until the PLL has measured it
+	pllRest = 0;
+	pllEpoch = lastPulseStart;
+	pllFraction = 0;
+	pllCount = 0;								// no candidate edge yet
+	pllGear = 0;
+	pllCoast = 0;
+	pllCoastAt = pllEpoch;
+#endif
+#if MSF_SAMPLED
+	sampled = sampleSync = sampleOff = sampleTrial = false;	// the interrupt is attached below
+	sampleOffA = sampleOffB = MSF_SOFT_WINDOW_LEN / 2;
+	sampleLast = sampleOnStart = lastPulseStart;
+	sampleStretch = 0;
+#endif
+#if MSF_RECORD_SIZE
+	recording = false;							// record() starts a recording
+	recordHead = recordTail = 0;
+	RecordDropped = 0;
+#endif
+#if MSF_STATS
+	clearStats();
+#endif
+#if MSF_QUALITY
+	qualityError = qualityOffset = qualityGlitches = 0;
+	qualityMissing = 100 << MSF_QUALITY_SHIFT;	// nothing received yet
+	qualityEdge = lastPulseStart;
+	qualityCount = qualityBad = 0;
+#endif
+#if MSF_INT_PINS
+	for(uint8_t i = 0; i < MSF_INT_PINS; i++)
+	{
+		// a decoder started again on another interrupt leaves the old one
+		if(msfInstances[i] == this && i != _intNum)
+		{
+			detachInterrupt(i);
+			msfInstances[i] = NULL;
+		}
+	}
+	if(_intNum < MSF_INT_PINS)
+	{
+		msfInstances[_intNum] = this;
+		attachInterrupt(_intNum, MsfIsrTable<MSF_INT_PINS - 1>::get(_intNum), CHANGE);
+	}
+#endif
 	return msfPin;
 }
 
+#if MSF_FEATURES & MSF_FEATURE_PON
 // turn the Receiver PON input ON (LOW) or OFF (HIGH)
 void MsfTimeLib::rxOn(uint8_t _rxOn)
 {
+	if(_rxOn == LOW && digitalRead(ponPin) == HIGH)
+	{
+		// the receiver was off: the seconds and minutes found before are lost, the time source may
+		// have wrapped any number of times since so they can not be counted on. now() runs on
+		noInterrupts();
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+		ringTail = ringHead;
+#endif
+		bitPointer = 0;
+		timeIsSet = false;
+		TimeReceived = 0;
+		NumSeconds = 0;
+		lastPulseStart = pulseStart = pulseEnd = timeSource();
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+		secondNumber = MSF_SECOND_UNKNOWN;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+		offStart = lastPulseStart;
+		spikeEnd = 0;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_PLL
+		pllGear = 0;
+#endif
+#if MSF_TRACK_RUN
+		trackTime = 0;
+#endif
+#if MSF_SAMPLED
+		sampleSync = sampleTrial = false;
+#endif
+#if MSF_VOTE_DEPTH
+		softMinutes = 0;
+		softSecond = -1;
+		softGeneration++;
+#endif
+		interrupts();
+	}
 	digitalWrite(ponPin, _rxOn);
 }
 
@@ -99,244 +514,1989 @@ uint8_t MsfTimeLib::rxIsOn(void)
 {
 	return digitalRead(ponPin);	// return the state of the ponPin. LOW = ON
 }
+#endif
 
-void MsfTimeLib::msfPulse(void)	// interrupt routine which is called every time the MSF receiver output changes state
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+// select where the edges are decoded. false (the default) decodes each edge inside the interrupt,
+// true makes the interrupt store only the edge time and level; poll() must then be called from loop().
+// Going back to false decodes the edges still queued first, so none is decoded late and out of order
+void MsfTimeLib::deferDecode(bool _defer)
 {
-// This routine is called every time the selected Interrupt pin changes state. If it is the start of
-// a pulse, the millis count is stored in "pulseStart". If it is the end of a pulse the millis count
-// is stored in "pulseEnd". "pulseLength" is the result in millis/100. The data is processed to produce an
-// integer 1 - 5 representing 100 - 500 ms pulses (no "4" is decoded). "secondBits" contains the binary data
-// for the "A" and "B" buffer contents. "secondBits" data is written as it is detected so, even a double "B"
-// pulse is written as an "A" bit first. When the second "B" bit is detected, the "bitBonly" flag is set
-// during the current second, and the pointer to the buffers is decremented one position which overwrites
-// the previous data.
-
-  bitBonly = false;					// clear the bitOnly flag
-  secondBits = 0;					// clear the secondBits variable
-  pinState = digitalRead(msfPin);	// get the state of the interrupt pin
-
-// is this a pulse start?
-  if (pinState == carrierOff)				// pulse or sub-pulse has started, carrier going off
-	{
-		pulseStart = millis();				// pulseStart = current millis everytime the MSFPIN goes low
-		if(timeIsSet)						// this is the first second of the new minute
-		{
-			TimeAvailable = 1;				// set flag for user to sync minute if this is the first second of the minute
-			timeIsSet = false;			// clear the flag to prevent false synchronisation
-			TimeReceived = 0;				// clear the flag to prevent false synchronisation
-			NumSeconds = 0;					// number of seconds counter
-		}
-		//startOfSecond = true;					// set this flag for later use
-		if(ledPin)	digitalWrite(ledPin,HIGH);	// turn on LED if designated ledPin > 0
-		return;									// until there's a another interrupt change
-	}
-
-// is this a pulse end?
-  if(pinState != carrierOff)								// pulse end, carrier going on
-	{
-		pulseEnd = millis();								// set the pulse end ms
-		//startOfSecond = false;								// clear the start of second flag
-		TimeAvailable = 0;									// clear the user flag
-		TimeReceived = 0;
-		// get the pulse length in ms/100 plus padding
-		//pulseLength = abs(((pulseEnd - pulseStart)+ padding) / 100);
-		pulseLength = ((pulseEnd - pulseStart)+ padding) / 100;
-		if (!pulseLength) return;							// if the pulse is too short ("0"), return
-		pulseStart = millis();								// set the pulseStart to current millis
-		// if the sequence was 100ms off + 100ms on + 100ms off, this is a 'B' stream only bit
-		// so, if this start pulse is less than 300ms after the last start pulse it must be
-		// a double 100ms pulse second
-		if(pulseStart - lastPulseStart < 300) bitBonly = true;	// this is a 'B' bit
-	    lastPulseStart = pulseStart;							// keep the last pulse start ms count
-		if(ledPin) digitalWrite(ledPin,LOW);					// turn off the LED if designated ledPin > 0
-	}
-
- switch(pulseLength)	// start processing the valid pulse
+	if(!_defer && deferred)
 	{
-		case 5:	// start pulse i.e. 500ms/100
-			bitPointer = 0;								// clear the buffer bit pointer
-			memset(&aBuffer[0], 0xFF, sizeof(aBuffer));	// clear the "A" buffer to all "1"s
-			memset(&bBuffer[0], 0, sizeof(bBuffer));	// clear the "B" buffer to all "0"s
-			break;
-		case 4:	// in the unlikely event we get a "4" quit
-			return;
-		case 3:	// check for 300ms/100 pulse, this is an 'A' + 'B' bit case
-			secondBits = 0b11;	// both "A" and "B" bits are set
-			break;
-		case 2:	// check for 200ms/100 pulse, this is an 'A' bit case
-			secondBits = 0b01;	// only the "A" bit is set
-			break;
-		case 1:	// check for 100ms/100 pulse
-			secondBits = 0b00;
-			if(bitBonly) secondBits = 0b10;		// only the "B" bit is set
-			break;			
+		poll();								// most of them with the interrupt still queueing
+		noInterrupts();
+		poll();								// the ones that came meanwhile
+		deferred = false;
+		interrupts();
+		return;
 	}
+	deferred = _defer;
+}
+#endif
 
-// store the data in the arrays
-  if(pulseLength < 5)  // only pass this point if it's not a "Start" pulse e.g. < 500ms
-	{
-		bitPointer++;						// increment the bit pointer which always starts at 1
-		if(bitBonly)
-		{
-			bitPointer--;			// if this is a "B" bit, decrement the bit pointer as	
-		}							// we have already written 0 bits to both the "A" and "B" buffers
-		else NumSeconds++;			// increment the NumSeconds counter
-	// store the bit in the "A" buffer
-		bitWrite(aBuffer[abs(bitPointer/8)], (bitPointer % 8) ^ 0x07, bitRead(secondBits,0));
-	// store the bit in the "B" buffer
-		bitWrite(bBuffer[abs(bitPointer/8)], (bitPointer % 8) ^ 0x07, bitRead(secondBits,1));
-
-// we detect the last second of the minute by looking for the binary sequence "01111110" in the "A" buffer
-// bits 52 thru 59. If we see this sequence it's time to stop decoding and start working on the data received
-// However, if this sequence contains +/- leap seconds we need to cater for this so, we start looking for the final
-// 0b01111110 bit sequence at bit 51.
+// true = the voting decoder runs next to the normal one. It keeps how sure it was of every bit
+// of the last MSF_VOTE_DEPTH minutes and combines them, giving a time when single minutes fail
+// their parity. It needs about 1ms at the start of each minute on a 16MHz AVR, use deferDecode()
+// if that is too long for the interrupt
+void MsfTimeLib::voteDecode(bool _vote)
+{
+#if MSF_VOTE_DEPTH
+	voting = _vote;
+#else
+	(void)_vote;
+#endif
+}
 
-  if(bitPointer > 57 && getChunk(aBuffer, bitPointer - MSF_MARKER_OFFSET, MSF_MARKER_BITS) == MSF_MARKER)
-	{
-		TimeReceived = 1;						// an early indicator that data wil be available for processing
-		//TimeAvailable = 0;					// clear the user time available flag
-		ParityResult = getParity();				// check the parity of the data, Good = 0
+// true = a minute that fails its parity in up to MSF_REPAIR_GROUPS groups is mended when flipping one
+// bit of each can give the minute expected from a fix less than an hour old. Nothing is mended before
+// the first fix. The fields of every minute (BCD digits, month, date, weekday) are checked, with or
+// without it
+void MsfTimeLib::repairDecode(bool _repair)
+{
+#if MSF_REPAIR_GROUPS
+	repairing = _repair;
+#else
+	(void)_repair;
+#endif
+}
 
-// ParityResult return 0 if the parity was good. If the parity check failed the following values are returned
-// 1	The Year data parity check failed
-// 2	The Month data parity check failed
-// 3	The Day of week data parity check failed
-// 4	The Time data parity check failed
-			
-// if the parity is OK, get the data from the "A" buffer into the variables. The MSF data is in BCD so we convert
-// it to decimal here for the Time library. You would leave it as BCD for a RTC such as the DS1307
+// true = after a fix the next minutes are predicted and each second received is compared with the
+// prediction at the second the time since the last match gives it. A minute in which MSF_TRACK_RUN
+// seconds in a row of the time data match gives the time at its end when the normal decoder has not,
+// so after a short fade the time comes back without a START pulse and 58 good seconds
+void MsfTimeLib::trackDecode(bool _track)
+{
+#if MSF_TRACK_RUN
+	noInterrupts();
+	tracking = _track;
+	trackTime = 0;								// from the next fix
+	interrupts();
+#else
+	(void)_track;
+#endif
+}
 
-  if(!ParityResult && bitPointer >= MIN_STREAM_LEN)	// make sure there are enough bits to work on e.g. 58 or more seconds worth
+// true = the interrupt is detached and the sketch reads the receiver pin (any pin) and gives the level
+// to feedSample() every 2 - 10ms, from a timer interrupt or from loop(). Each second is matched with
+// the pulse templates over all its samples, which stands more noise than timing the edges and takes
+// the same time for every sample. Call it after begin(), which attaches the interrupt again
+void MsfTimeLib::sampleDecode(bool _sampled)
+{
+#if MSF_SAMPLED
+	noInterrupts();
+	sampled = _sampled;
+	sampleSync = sampleTrial = false;
+	interrupts();
+#if MSF_INT_PINS
+	for(uint8_t i = 0; i < MSF_INT_PINS; i++)
 	{
-		// The number of bits decoded indicates if there was a Leap Second event
-		if(bitPointer == 58) LeapSecond = -1;
-		else if(bitPointer == 60) LeapSecond = 1;
-		else LeapSecond = 0;
-		// copy the BCD date & time date from the "A" buffer to the rtcBuffer
-		rtcBuffer[MSF_SECOND] = 0;
-		rtcBuffer[MSF_MINUTE] = getChunk(aBuffer, bitPointer - MSF_MINUTE_OFFSET,MSF_MINUTE_BITS);	// minute
-		rtcBuffer[MSF_HOUR] = getChunk(aBuffer, bitPointer - MSF_HOUR_OFFSET,MSF_HOUR_BITS);		// hour
-		rtcBuffer[MSF_DAY] = getChunk(aBuffer, bitPointer - MSF_WEEKDAY_OFFSET,MSF_WEEKDAY_BITS);	// weekday
-		rtcBuffer[MSF_DATE] = getChunk(aBuffer, bitPointer - MSF_DATE_OFFSET,MSF_DATE_BITS);		// date
-		rtcBuffer[MSF_MONTH] = getChunk(aBuffer, bitPointer - MSF_MONTH_OFFSET,MSF_MONTH_BITS);		// month
-		rtcBuffer[MSF_YEAR] = getChunk(aBuffer, bitPointer - MSF_YEAR_OFFSET,MSF_YEAR_BITS);		// year	(offset, number of bits to read)
-		TimeTime = makeTime();											// make a time_t compatible for Time/RTC library use
-		RxSecs = bitPointer + 1;										// number of seconds received
-		Bst = getBit(bBuffer, bitPointer - MSF_BST_BIT_POS);			//BST = 1, GMT = 0
-		BstSoon = getBit(bBuffer, bitPointer - MSF_BSTSOON_BIT_POS);	// BST imminent = 1
-		getChunk(bBuffer, 1,8);											// get DUT1 Positive bit count
-		DutPos = bitCounter * 100;
-		getChunk(bBuffer, 9,8);											// get DUT1 Negative bit count
-		DutNeg = bitCounter * 100;
-		timeIsSet = true;												// set flag for next start of minute
-	}
+		if(msfInstances[i] != this) continue;
+		if(_sampled) detachInterrupt(i);
+		else attachInterrupt(i, MsfIsrTable<MSF_INT_PINS - 1>::get(i), CHANGE);
 	}
-  }
-}// End of "msfPulse" Interrupt Routine
-
-/* Everything beyond this point is for decoding and parity checking */
+#endif
+#else
+	(void)_sampled;
+#endif
+}
 
-uint8_t MsfTimeLib::getChunk(uint8_t * _buffer, uint8_t _start, uint8_t _numBits)
+#if MSF_FEATURES & MSF_FEATURE_CLOCK
+// the edges are timestamped with micros() by default. A function that reads a free running hardware
+// timer (or a timer input capture register) in us gives less jitter, it is called in the interrupt
+void MsfTimeLib::setTimeSource(MsfTimeSource _source)
 {
-	// return the byte/time 'chunk' containing the number of bits read at the starting
-	// bit position in the Raw Buffer up to 8 bits. returns a Byte
-	uint8_t chunk = 0;
-	uint8_t bitVal = 0;
-	uint8_t counter = _numBits - 1;
-	bitCounter = 0;				// a count of the number of "1" bits
-  
-  for(uint16_t i = _start;i < _start + _numBits;i++)		// loop for numBits
-	{
-		// return the value of the single bit (bitPos) from the "A" buffer
-		bitVal = bitRead(_buffer[abs(i/8)], (i % 8) ^ 0x07);	// get the bit from the buffer
-		bitWrite(chunk,counter,bitVal);							// write the bit to "chunk"
-		if(bitVal) bitCounter++;								// if it's a "1" increment the bitCounter
-		counter--;												// decrement the counter
-	}
-  return chunk;
+	timeSource = _source ? _source : micros;
 }
+#endif
 
-uint8_t MsfTimeLib::getParity()
+// the callbacks are called from the interrupt, or from poll() with deferDecode(true), and must be as
+// short as an interrupt routine then. onMinute() comes at the first edge of the minute, the time that
+// sets TimeAvailable, onSecond() at the end of the pulse of each second with the time of its carrier
+// OFF edge and onDecodeError() at the end of a minute whose parity failed (see ParityResult)
+#if MSF_FEATURES & MSF_FEATURE_FIX
+void MsfTimeLib::onMinute(MsfMinuteCallback _callback)
 {
-	// calculate the parity bits and return true if all's well
-	// all data and parity bits are relative to the last second count copntained in "bitPointer"
-	// this allows for leap seconds which are added or removed at second 16 i.e. before
-	// the actual date & time data. There can be 59 or 61 seconds in a leep minute
-	// Year data parity check
-	if(!checkParity(bitPointer - MSF_YEAR_OFFSET, MSF_YEAR_PARITY_BITS, bitPointer - MSF_YEAR_PARITY_BIT_POS)) return 1;
-	// Month data parity check
-	if(!checkParity(bitPointer - MSF_MONTH_OFFSET, MSF_MONTH_PARITY_BITS, bitPointer - MSF_MONTH_PARITY_BIT_POS)) return 2;
-	// Day of week data parity check
-	if(!checkParity(bitPointer - MSF_WEEKDAY_OFFSET, MSF_WEEKDAY_PARITY_BITS, bitPointer - MSF_WEEKDAY_PARITY_BIT_POS)) return 3;
-	// Time data parity check
-	if(!checkParity(bitPointer - MSF_HOUR_OFFSET, MSF_HOUR_PARITY_BITS, bitPointer - MSF_HOUR_PARITY_BIT_POS)) return 4;
-	return 0;
+	minuteCallback = _callback;
 }
+#endif
 
-bool MsfTimeLib::checkParity(uint8_t _start, uint8_t _numBits, uint8_t _parityBitNum)
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+void MsfTimeLib::onSecond(MsfSecondCallback _callback)
 {
-	// count the number of "1" bits in the specified chunk of the "A" buffer
-	// then add the parity bit to the result
-	uint8_t parity = 0;
-  for(uint16_t i = _start;i < _start + _numBits;i++)	// loop for numBits
-	{
-		// add the bits to "parity"
-		parity += getBit(aBuffer, i);
-	}
-	// now add the actual parity bit to parity
-	parity += getBit(bBuffer, _parityBitNum);	// add the parity bit
-	if(parity & 0x01) return true;			// return true if parity is negative e.g. Good
-	return false;
+	secondCallback = _callback;
 }
 
-bool MsfTimeLib::getBit(uint8_t * _buffer, uint8_t _bitPos)
+void MsfTimeLib::onDecodeError(MsfErrorCallback _callback)
 {
-	// return the value of the single bit (_bitPos) from the _buffer
-	// the bits are numbered from MSB (0) to LSB (7)
-	return bitRead(_buffer[abs(_bitPos/8)], (_bitPos % 8) ^ 0x07);
+	errorCallback = _callback;
 }
+#endif
 
-#define LEAP_YEAR(Y)     ( ((1970+Y)>0) && !((1970+Y)%4) && ( ((1970+Y)%100) || !((1970+Y)%400) ) )
-#define SECS_PER_MIN  (60UL)
-#define SECS_PER_HOUR (3600UL)
-#define SECS_PER_DAY  (SECS_PER_HOUR * 24UL)
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+// carrier OFF pulses shorter than _ms are spikes and are ignored, a carrier ON gap shorter than _ms
+// inside a pulse is taken out and the pulse is measured from its real start to its real end. MSF
+// pulses and gaps are never shorter than 100ms, 0 turns the filter off
+void MsfTimeLib::setGlitchFilter(uint8_t _ms)
+{
+	glitchUs = _ms * 1000UL;
+}
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+uint8_t MsfTimeLib::poll(void)
+{
+	// decode the edges queued by the interrupt in the order they arrived and return how many
+	// were processed. Only poll() moves ringTail and only the interrupt moves ringHead so the
+	// ring needs no locking
+	uint8_t count = 0;
+	while(ringTail != ringHead)
+	{
+		processEdge(edgeTime[ringTail], edgeLevel[ringTail]);
+		ringTail = (ringTail + 1) & (MSF_EDGE_RING_SIZE - 1);
+		count++;
+	}
+	return count;
+}
+#endif
+
+void MsfTimeLib::msfPulse(void)	// interrupt routine which is called every time the MSF receiver output changes state
+{
+	bool level = digitalRead(msfPin);	// get the state of the interrupt pin
+	uint32_t now = timeSource();
+#if MSF_RECORD_SIZE
+	if(recording) recordEdge(now, level);
+#endif
+	edge(now, level);
+#if MSF_STATS
+	statsTime(stats.isr, timeSource() - now);
+#endif
+}
+
+// the same for an edge the sketch has timed itself (a timer input capture, a recorded trace) with
+// begin(MSF_NO_INTERRUPT). Nothing is shared between decoders started that way, so each one can be
+// fed from a thread of its own on a host
+void MsfTimeLib::feedEdge(uint32_t _time, uint8_t _level)
+{
+#if MSF_RECORD_SIZE
+	if(recording) recordEdge(_time, _level);
+#endif
+	edge(_time, _level);
+}
+
+void MsfTimeLib::edge(uint32_t _time, bool _level)
+{
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+	if(!deferred)
+#endif
+	{
+		processEdge(_time, _level);		// decode the edge here and now
+		return;
+	}
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+	// deferred mode: push the edge into the ring for poll()
+	uint8_t next = (ringHead + 1) & (MSF_EDGE_RING_SIZE - 1);
+	if(next == ringTail)				// ring full, poll() is not keeping up
+	{
+		EdgeOverflows++;
+		return;
+	}
+	edgeTime[ringHead] = _time;
+	edgeLevel[ringHead] = _level;
+	ringHead = next;
+#endif
+}
+
+#if MSF_RECORD_SIZE
+void MsfTimeLib::recordEdge(uint32_t _time, bool _level)
+{
+// Each edge is stored as (time since the edge before in 2^MSF_RECORD_SHIFT us) * 2 + pin level in
+// 7 bit groups, lowest first, bit 7 set on all but the last: an edge a second or less after the one
+// before takes 2 bytes. recordTime moves on by whole units so the rounding never adds up. When the
+// ring is full the oldest edges are dropped.
+
+	uint32_t units = (_time - recordTime) >> MSF_RECORD_SHIFT;
+	recordTime += units << MSF_RECORD_SHIFT;
+	uint32_t value = units << 1 | _level;
+	uint8_t bytes = 1;
+	for(uint32_t v = value >> 7; v; v >>= 7) bytes++;
+	uint16_t head = recordHead, tail = recordTail;
+	for(;;)
+	{
+		uint16_t used = head >= tail ? head - tail : head + MSF_RECORD_SIZE - tail;
+		if(used + bytes < MSF_RECORD_SIZE) break;
+		while(recordRing[tail] & 0x80) tail = tail + 1 == MSF_RECORD_SIZE ? 0 : tail + 1;
+		tail = tail + 1 == MSF_RECORD_SIZE ? 0 : tail + 1;
+		RecordDropped++;
+	}
+	while(bytes--)
+	{
+		recordRing[head] = (value & 0x7F) | (bytes ? 0x80 : 0);
+		value >>= 7;
+		head = head + 1 == MSF_RECORD_SIZE ? 0 : head + 1;
+	}
+	recordTail = tail;
+	recordHead = head;
+}
+
+// true = forget the edges recorded so far and record from now on, false = stop (the recording is
+// kept for dumpRecord()). The first edge is timed from the call. Call it after begin()
+void MsfTimeLib::record(bool _record)
+{
+	noInterrupts();
+	if(_record)
+	{
+		recordHead = recordTail = 0;
+		recordTime = timeSource();
+		RecordDropped = 0;
+	}
+	recording = _record;
+	interrupts();
+}
+
+uint16_t MsfTimeLib::recordBytes(void)
+{
+	noInterrupts();
+	uint16_t head = recordHead, tail = recordTail;
+	interrupts();
+	return head >= tail ? head - tail : head + MSF_RECORD_SIZE - tail;
+}
+
+// writes the recording as text, 32 bytes to a line in hex, with a header giving the format version,
+// the time unit in us, the carrier OFF level given to begin() and the number of bytes:
+//
+//	MSFREC 1 1024 1 586
+//	8E07...
+//	END
+//
+// The recording stops while it is written (Serial may be slow) and goes on afterwards, the edges
+// in between are lost. msf_replay in extras/host replays the output
+void MsfTimeLib::dumpRecord(Print &_out)
+{
+	static const char hexDigits[] = "0123456789ABCDEF";
+	noInterrupts();
+	bool was = recording;
+	recording = false;
+	interrupts();
+	uint16_t bytes = recordBytes();
+	_out.print("MSFREC 1 ");
+	_out.print(1UL << MSF_RECORD_SHIFT);
+	_out.print(" ");
+	_out.print((unsigned long)carrierOff);
+	_out.print(" ");
+	_out.print((unsigned long)bytes);
+	_out.println();
+	uint16_t pos = recordTail;
+	for(uint16_t i = 0; i < bytes; i++)
+	{
+		uint8_t b = recordRing[pos];
+		_out.write(hexDigits[b >> 4]);
+		_out.write(hexDigits[b & 0x0F]);
+		if((i & 31) == 31 || i + 1 == bytes) _out.println();
+		pos = pos + 1 == MSF_RECORD_SIZE ? 0 : pos + 1;
+	}
+	_out.print("END");
+	_out.println();
+	noInterrupts();
+	recording = was;
+	interrupts();
+}
+#endif
+
+#if MSF_STATS
+void MsfTimeLib::statsTime(MsfStatsTime &_time, uint32_t _us)
+{
+	uint16_t us = _us > 0xFFFF ? 0xFFFF : _us;
+	if(us < _time.min) _time.min = us;
+	if(us > _time.max) _time.max = us;
+	_time.sum += us;
+	_time.count++;
+}
+
+// the statistics tell a weak or noisy signal (short and 400ms pulses, parity failures, few minutes
+// decoded for those started) from a busy CPU (long interrupts, see notes.txt). The times are measured
+// with the time source so they are only as fine as it is, micros() counts in 4us on a 16MHz AVR
+void MsfTimeLib::getStats(MsfStats &_stats)
+{
+	noInterrupts();
+	_stats = stats;
+	interrupts();
+}
+
+void MsfTimeLib::clearStats(void)
+{
+	noInterrupts();
+	memset(&stats, 0, sizeof(stats));
+	stats.isr.min = stats.minute.min = 0xFFFF;
+	interrupts();
+}
+#endif
+
+#if MSF_SAMPLED
+void MsfTimeLib::feedSample(uint8_t _level)
+{
+// A second starts with the carrier going OFF. While searching that is the first OFF sample after at
+// least 400ms of carrier ON (every second ends with 500ms of it), then the OFF sample that comes
+// within MSF_SAMPLE_WINDOW ms of the expected time, or the expected time if there is none. The edge
+// lies between two samples so half way is taken. A carrier ON sample in the first MSF_SAMPLE_SPIKE ms
+// makes it a spike and the second before goes on. The decoder is given the carrier OFF edge at once
+// (TimeAvailable is set by it at the start of a minute), the samples of the first 500ms are counted
+// in 100ms windows and matched 500ms into the second and the decoder is given the rest of the edges
+// of the template that fits best. The windows are moved by the lengthening of the receiver, measured
+// from the first carrier ON of each second matched, so a long pulse end does not fall in the next one.
+
+	if(!sampled) return;
+	uint32_t now = timeSource();
+	bool off = _level == carrierOff;
+	uint32_t edgeTime = now - (now - sampleLast) / 2;
+	bool start = off && !sampleOff;
+#if MSF_RECORD_SIZE
+	if(recording && off != sampleOff) recordEdge(edgeTime, _level);
+#endif
+	if(!off && sampleOff)
+	{
+		sampleOnStart = edgeTime;
+		if(sampleSync && !samplePulseEnd) samplePulseEnd = edgeTime - sampleStart;
+	}
+	sampleOff = off;
+	sampleLast = now;
+	if(sampleTrial && now - sampleStart >= MSF_SAMPLE_SPIKE * 1000UL) sampleTrial = false;
+	else if(sampleTrial && !off)
+	{
+		edge(edgeTime, !carrierOff);			// the decoder throws the spike away as well
+		sampleStart = sampleTrialStart;
+		sampleSync = sampleTrialSync;
+		sampleDone = true;
+		sampleTrial = false;
+	}
+	if(start && (sampleSync ? edgeTime - sampleStart >= (1000 - MSF_SAMPLE_WINDOW) * 1000UL : edgeTime - sampleOnStart >= 400000UL))
+	{
+		sampleTrialStart = sampleStart;
+		sampleTrialSync = sampleSync;
+		sampleTrial = true;
+		if(!sampleSync) sampleMisses = MSF_SAMPLE_MISSES - 1;	// one second without a match and the search goes on
+		sampleSync = true;
+		sampleSecond(edgeTime);
+	}
+	else if(sampleSync && now - sampleStart >= (1000 + MSF_SAMPLE_WINDOW) * 1000UL) sampleSecond(sampleStart + 1000000UL);
+	if(!sampleSync) return;
+	uint32_t offset = now - sampleStart;
+	int32_t windows = offset - sampleStretch;	// the 100ms windows move with the receiver's lengthening
+	if(windows < 500000L)
+	{
+		uint8_t w = 0;
+		for(int32_t end = 100000L; windows >= end; end += 100000L) w++;	// no division in the interrupt
+		if(sampleCount[w] < 255)
+		{
+			sampleCount[w]++;
+			sampleOffCount[w] += off;
+		}
+		for(uint8_t b = 0; b < 2; b++)
+		{
+			uint32_t from = (b ? MSF_SOFT_B_WINDOW : MSF_SOFT_A_WINDOW) * 1000UL;
+			if(offset - from < MSF_SOFT_WINDOW_LEN * 1000UL && sampleSoftCount[b] < 255)
+			{
+				sampleSoftCount[b]++;
+				sampleSoftOff[b] += off;
+			}
+		}
+	}
+	else if(!sampleDone) sampleMatch();
+}
+
+void MsfTimeLib::sampleSecond(uint32_t _start)
+{
+	sampleStart = _start;
+	sampleDone = false;
+	samplePulseEnd = 0;
+	edge(_start, carrierOff);
+	memset(sampleCount, 0, sizeof(sampleCount));
+	memset(sampleOffCount, 0, sizeof(sampleOffCount));
+	memset(sampleSoftCount, 0, sizeof(sampleSoftCount));
+	memset(sampleSoftOff, 0, sizeof(sampleSoftOff));
+}
+
+void MsfTimeLib::sampleMatch(void)
+{
+// The match of a template is the samples that agree with it less those that do not, as a part of all
+// the samples. Each window adds its OFF less ON samples where the template is OFF and takes them
+// away where it is ON, so the windows are summed once and each template costs five additions.
+
+	sampleDone = true;
+	// the voting decoder is given how long the carrier was OFF in its windows from the samples, not
+	// from the template edges. It reads them at the start of the next second (in deferred mode poll()
+	// must run within 500ms of it)
+	sampleOffA = sampleSoftCount[0] ? sampleSoftOff[0] * MSF_SOFT_WINDOW_LEN / sampleSoftCount[0] : MSF_SOFT_WINDOW_LEN / 2;
+	sampleOffB = sampleSoftCount[1] ? sampleSoftOff[1] * MSF_SOFT_WINDOW_LEN / sampleSoftCount[1] : MSF_SOFT_WINDOW_LEN / 2;
+	int16_t window[5];
+	int16_t total = 0, samples = 0;
+	for(uint8_t w = 0; w < 5; w++)
+	{
+		window[w] = 2 * sampleOffCount[w] - sampleCount[w];
+		total += window[w];
+		samples += sampleCount[w];
+	}
+	int16_t best = -32767;
+	uint8_t match = 0;
+	for(uint8_t t = 0; t < 5; t++)
+	{
+		uint8_t bits = pgm_read_byte(&sampleTemplates[t]);
+		int16_t score = -total;
+		for(uint8_t w = 0; w < 5; w++)
+		{
+			if(bits & (1 << w)) score += 2 * window[w];
+		}
+		if(score > best)
+		{
+			best = score;
+			match = bits;
+		}
+	}
+	// every pulse starts with 100ms of carrier OFF. A second without it has no pulse: the 100ms
+	// template matches most of its samples, but it is a lost second (as it is to the edges) and not
+	// a 0, and the voting decoder is given nothing for it
+	if(window[0] > 0) sampleMisses = 0;
+	else
+	{
+		sampleOffA = sampleOffB = MSF_SOFT_WINDOW_LEN / 2;
+		if(++sampleMisses >= MSF_SAMPLE_MISSES) sampleSync = false;
+	}
+	if(window[0] <= 0 || (int32_t)best * 100 < (int32_t)MSF_SAMPLE_MATCH * samples)
+	{
+		edge(sampleStart + 1000UL, !carrierOff);	// no pulse the decoder knows, it throws a 1ms one away
+		return;
+	}
+	// the first carrier ON ends the first OFF part of the template, how much later is the lengthening
+	// of the receiver (MSF_AUTO_RANGE at most, a spike ends it early), followed as a running average
+	uint8_t first = 1;
+	while(first < 5 && (match & (1 << first))) first++;
+	int32_t stretch = (int32_t)samplePulseEnd - first * 100000L;
+	if(samplePulseEnd && stretch > -MSF_AUTO_RANGE * 1000L && stretch < MSF_AUTO_RANGE * 1000L)
+		sampleStretch += (stretch - sampleStretch) / 8;
+	bool was = true;
+	for(uint8_t w = 1; w <= 5; w++)
+	{
+		bool off = w < 5 && (match & (1 << w));
+		if(off != was) edge(sampleStart + w * 100000UL, off ? carrierOff : !carrierOff);
+		was = off;
+	}
+}
+#endif
+
+void MsfTimeLib::processEdge(uint32_t _time, bool _level)
+{
+// This routine is called for every change of the selected Interrupt pin. If it is the start of
+// a pulse, the micros count is stored in "pulseStart". If it is the end of a pulse the micros count
+// is stored in "pulseEnd". "pulseLength" is the result in ms/100. The data is processed to produce an
+// integer 1 - 5 representing 100 - 500 ms pulses (no "4" is decoded). "secondBits" contains the binary data
+// for the "A" and "B" buffer contents. "secondBits" data is written as it is detected so, even a double "B"
+// pulse is written as an "A" bit first. When the second "B" bit is detected, the "bitBonly" flag is set
+// during the current second, and the pointer to the buffers is decremented one position which overwrites
+// the previous data.
+
+#if MSF_VOTE_DEPTH
+  if(voting) softEdge(_time, _level == carrierOff);	// measure the edge for the voting decoder first
+#endif
+  bitBonly = false;					// clear the bitOnly flag
+  secondBits = 0;					// clear the secondBits variable
+  pinState = _level;				// the state of the interrupt pin at the edge
+
+// is this a pulse start?
+  if (pinState == carrierOff)				// pulse or sub-pulse has started, carrier going off
+	{
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+		if(_time - pulseEnd < glitchUs)		// the carrier was only ON for a glitch, the pulse goes on
+		{
+			pulseStart = offStart;
+			lastPulseStart = gapStart;			// as it was before the first part of the pulse ended
+			gapMerged = bitPushed;				// the end of the pulse replaces the bit of the first part
+			timeIsSet = false;					// the minute end found at the gap is checked again
+			GlitchGaps++;
+#if MSF_FEATURES & MSF_FEATURE_LED
+			if(ledPin)	digitalWrite(ledPin,HIGH);
+#endif
+			return;
+		}
+		if(spikeEnd && _time - spikeEnd < glitchUs)
+		{
+			// the "spike" was the start of this pulse with a gap after it
+			_time = spikeOff;
+			GlitchPulses--;
+			GlitchGaps++;
+		}
+		spikeEnd = 0;
+		spikeStart = pulseStart;			// kept in case this is a spike
+		spikeOff = offStart;
+		offStart = _time;
+#endif
+		pulseStart = _time;					// pulseStart = edge micros everytime the MSFPIN goes low
+#if MSF_TRACK_RUN
+		if(trackTime && !timeIsSet && trackEnd(_time))
+		{
+			// the decoder lost this minute but tracking confirmed it
+			publishFix(_time, false);
+			TimeAvailable = 1;
+			TimeReceived = 0;
+			NumSeconds = 0;
+		}
+#endif
+		// this is the first second of the new minute, a spike later in second 59 is not
+		if(timeIsSet && _time - lastPulseStart >= 750000UL)
+		{
+			// after lost seconds this edge is later than the minute start, a second (as the PLL has
+			// measured it) after the start of second 59
+			bool late = _time - markerStart > 1500000UL;
+			publishFix(late ? markerStart + MSF_PERIOD_US : _time, late);
+			TimeAvailable = 1;				// set flag for user to sync minute if this is the first second of the minute
+			timeIsSet = false;			// clear the flag to prevent false synchronisation
+			TimeReceived = 0;				// clear the flag to prevent false synchronisation
+			NumSeconds = 0;					// number of seconds counter
+		}
+		//startOfSecond = true;					// set this flag for later use
+#if MSF_FEATURES & MSF_FEATURE_LED
+		if(ledPin)	digitalWrite(ledPin,HIGH);	// turn on LED if designated ledPin > 0
+#endif
+		return;									// until there's a another interrupt change
+	}
+
+// is this a pulse end?
+  bool replace = false;
+  uint32_t secondStart = 0;
+  if(pinState != carrierOff)								// pulse end, carrier going on
+	{
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+		if(_time - offStart < glitchUs)						// a spike, undo its start
+		{
+			uint32_t start = offStart;
+			pulseStart = spikeStart;
+			offStart = spikeOff;
+			spikeOff = start;								// in case a gap follows
+			spikeEnd = _time | 1;							// 0 = no spike
+			GlitchPulses++;
+#if MSF_FEATURES & MSF_FEATURE_LED
+			if(ledPin) digitalWrite(ledPin,LOW);
+#endif
+			return;
+		}
+		gapStart = lastPulseStart;							// kept in case a gap follows
+#endif
+		pulseEnd = _time;									// set the pulse end us
+#if MSF_STATS
+		uint8_t bin = 0;									// no division in the interrupt
+		for(uint32_t end = MSF_STATS_BIN * 1000UL; pulseEnd - pulseStart >= end && bin < MSF_STATS_BINS - 1; end += MSF_STATS_BIN * 1000UL) bin++;
+		stats.pulses[bin]++;
+#endif
+		replace = gapMerged;								// this pulse had a gap, replace the bit of its first part
+		gapMerged = bitPushed = false;
+		//startOfSecond = false;								// clear the start of second flag
+		TimeAvailable = 0;									// clear the user flag
+		TimeReceived = 0;
+		// get the pulse length in ms/100 plus padding
+		//pulseLength = abs(((pulseEnd - pulseStart)+ padding) / 100);
+#if MSF_AUTO_BINS
+		if(autoPad) pulseLength = pulseClassify(pulseEnd - pulseStart);
+		else
+#endif
+		pulseLength = ((pulseEnd - pulseStart) + padding * 1000L) / 100000UL;
+		if (!pulseLength)									// if the pulse is too short ("0"), return
+		{
+#if MSF_STATS
+			stats.shortPulses++;
+#endif
+#if MSF_QUALITY
+			if(qualityBad < 0xFF) qualityBad++;
+#endif
+			return;
+		}
+		secondStart = pulseStart;							// the carrier OFF edge of this pulse
+		pulseStart = _time;									// set the pulseStart to the edge micros
+		// if the sequence was 100ms off + 100ms on + 100ms off, this is a 'B' stream only bit
+		// so, if this start pulse is less than 300ms after the last start pulse it must be
+		// a double 100ms pulse second
+		if(pulseStart - lastPulseStart < 300000UL) bitBonly = true;	// this is a 'B' bit
+#if MSF_STATS
+		stats.bitBonly += bitBonly;
+#endif
+	    lastPulseStart = pulseStart;							// keep the last pulse start us count
+		// a valid pulse that is not the second 'B' pulse started at the start of a second
+#if MSF_FEATURES & MSF_FEATURE_PLL
+		if(!bitBonly && pulseLength <= 5 && pulseLength != 4) pllEdge(secondStart);
+#endif
+#if MSF_QUALITY
+		if(pulseLength <= 5 && pulseLength != 4) qualityPulse(secondStart, pulseEnd - secondStart, !bitBonly);
+#endif
+#if MSF_FEATURES & MSF_FEATURE_LED
+		if(ledPin) digitalWrite(ledPin,LOW);					// turn off the LED if designated ledPin > 0
+#endif
+	}
+
+ switch(pulseLength)	// start processing the valid pulse
+	{
+		case 5:	// start pulse i.e. 500ms/100
+			bitPointer = 0;								// clear the buffer bit pointer
+			memset(&aBits, 0xFF, sizeof(aBits));		// clear the "A" buffer to all "1"s
+			memset(&bBits, 0, sizeof(bBits));			// clear the "B" buffer to all "0"s
+			memset(&parityBits, 0, sizeof(parityBits));	// clear the running parity
+#if MSF_STATS
+			stats.minutesStarted++;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+			if(secondCallback) callSecond(secondStart, true);
+#endif
+#if MSF_TRACK_RUN
+			if(trackTime) trackPulse(secondStart, MSF_TRACK_START, false);
+#endif
+			break;
+		case 4:	// in the unlikely event we get a "4" quit
+#if MSF_STATS
+			stats.pulses400++;
+#endif
+#if MSF_QUALITY
+			if(qualityBad < 0xFF) qualityBad++;
+#endif
+			return;
+		case 3:	// check for 300ms/100 pulse, this is an 'A' + 'B' bit case
+			secondBits = 0b11;	// both "A" and "B" bits are set
+			break;
+		case 2:	// check for 200ms/100 pulse, this is an 'A' bit case
+			secondBits = 0b01;	// only the "A" bit is set
+			break;
+		case 1:	// check for 100ms/100 pulse
+			secondBits = 0b00;
+			if(bitBonly) secondBits = 0b10;		// only the "B" bit is set
+			break;			
+	}
+
+// store the data in the arrays
+  if(pulseLength < 5)  // only pass this point if it's not a "Start" pulse e.g. < 500ms
+	{
+		bitPushed = true;
+		if(bitBonly || replace)
+		{
+			// this is a "B" bit, we have already written 0 bits to both the "A" and "B"
+			// buffers for this second so overwrite them (also the bits of a pulse cut short by a gap)
+			bitsReplace(aBits, secondBits & 0x01);
+			bitsReplace(bBits, secondBits >> 1);
+			bitsReplace(parityBits, bitsGet(parityBits, 1) ^ (secondBits & 0x01));
+#if MSF_TRACK_RUN
+			if(trackTime) trackPulse(secondStart, secondBits, true);
+#endif
+		}
+		else
+		{
+			bitPointer++;			// increment the bit pointer which always starts at 1
+			NumSeconds++;			// increment the NumSeconds counter
+			bitsPush(aBits, secondBits & 0x01);		// store the bit in the "A" buffer
+			bitsPush(bBits, secondBits >> 1);		// store the bit in the "B" buffer
+			// keep the running parity of every "A" bit received so far
+			bitsPush(parityBits, bitsGet(parityBits, 0) ^ (secondBits & 0x01));
+#if MSF_FEATURES & MSF_FEATURE_HOLD
+			// the marker without its last bit at second 59: the bits were moved on by a second put in
+			if(bitPointer == 59 && (bitsLow8(aBits) & 0x7F) == (MSF_MARKER >> 1)) leapAhead(secondStart, 1);
+#endif
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+			if(secondCallback) callSecond(secondStart, false);
+#endif
+#if MSF_TRACK_RUN
+			if(trackTime) trackPulse(secondStart, secondBits, false);
+#endif
+		}
+
+// we detect the last second of the minute by looking for the binary sequence "01111110" in the "A" buffer
+// bits 52 thru 59. If we see this sequence it's time to stop decoding and start working on the data received
+// However, if this sequence contains +/- leap seconds we need to cater for this so, we start looking for the final
+// 0b01111110 bit sequence at bit 51. The marker is always the last 8 bits received so this is a single
+// Byte compare each second.
+
+  if(bitPointer > 57 && bitsLow8(aBits) == MSF_MARKER)
+	{
+#if MSF_STATS
+		uint32_t decodeStart = timeSource();
+		stats.minutesEnded++;
+#endif
+		TimeReceived = 1;						// an early indicator that data wil be available for processing
+		//TimeAvailable = 0;					// clear the user time available flag
+		ParityResult = getParity();				// check the parity of the data, Good = 0
+#if MSF_STATS
+		if(ParityResult)
+		{
+			// getParity() stops at the first bad field, every field is counted here
+			stats.parityFails[0] += !checkParity(MSF_YEAR_OFFSET, MSF_YEAR_PARITY_BITS, MSF_YEAR_PARITY_BIT_POS);
+			stats.parityFails[1] += !checkParity(MSF_MONTH_OFFSET, MSF_MONTH_PARITY_BITS, MSF_MONTH_PARITY_BIT_POS);
+			stats.parityFails[2] += !checkParity(MSF_WEEKDAY_OFFSET, MSF_WEEKDAY_PARITY_BITS, MSF_WEEKDAY_PARITY_BIT_POS);
+			stats.parityFails[3] += !checkParity(MSF_HOUR_OFFSET, MSF_HOUR_PARITY_BITS, MSF_HOUR_PARITY_BIT_POS);
+		}
+#endif
+#if MSF_REPAIR_GROUPS
+		uint8_t fields[7];
+		bool good = repairFields(secondStart, fields);
+		if(!good && !ParityResult) ParityResult = MSF_PARITY_IMPOSSIBLE;
+#else
+		bool good = !ParityResult;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+		if(!good && errorCallback) errorCallback(ParityResult, secondStart);
+#endif
+		// the voting decoder sets it at the start of the minute
+		Confidence = !good ? 0 : ParityResult ? MSF_REPAIR_CONFIDENCE : 100;
+#if MSF_VOTE_DEPTH
+		if(voting) Confidence = 0;
+#endif
+
+// ParityResult return 0 if the parity was good. If the parity check failed the following values are returned
+// 1	The Year data parity check failed
+// 2	The Month data parity check failed
+// 3	The Day of week data parity check failed
+// 4	The Time data parity check failed
+// 5	The parity was good but the fields are impossible (MSF_PARITY_IMPOSSIBLE)
+// A minute mended by repairDecode() keeps its parity result (1 - 4) but gives the mended time
+			
+// if the parity is OK, get the data from the "A" buffer into the variables. The MSF data is in BCD so we convert
+// it to decimal here for the Time library. You would leave it as BCD for a RTC such as the DS1307
+
+  if(good && bitPointer >= MIN_STREAM_LEN)	// make sure there are enough bits to work on e.g. 58 or more seconds worth
+	{
+		// The number of bits decoded indicates if there was a Leap Second event
+		if(bitPointer == 58) LeapSecond = -1;
+		else if(bitPointer == 60) LeapSecond = 1;
+		else LeapSecond = 0;
+#if MSF_FEATURES & MSF_FEATURE_HOLD
+		if(LeapSecond < 0) leapAhead(secondStart, -1);	// the next second is the start of the minute
+#endif
+		// copy the BCD date & time date from the "A" buffer to the rtcBuffer
+		rtcBuffer[MSF_SECOND] = 0;
+#if MSF_REPAIR_GROUPS
+		for(uint8_t x = MSF_MINUTE; x <= MSF_YEAR; x++) rtcBuffer[x] = fields[x];	// as read or mended
+		if(ParityResult) RepairedMinutes++;
+#else
+		rtcBuffer[MSF_MINUTE] = getChunk(aBits, MSF_MINUTE_OFFSET, MSF_MINUTE_BITS);		// minute
+		rtcBuffer[MSF_HOUR] = getChunk(aBits, MSF_HOUR_OFFSET, MSF_HOUR_BITS);				// hour
+		rtcBuffer[MSF_DAY] = getChunk(aBits, MSF_WEEKDAY_OFFSET, MSF_WEEKDAY_BITS);			// weekday
+		rtcBuffer[MSF_DATE] = getChunk(aBits, MSF_DATE_OFFSET, MSF_DATE_BITS);				// date
+		rtcBuffer[MSF_MONTH] = getChunk(aBits, MSF_MONTH_OFFSET, MSF_MONTH_BITS);			// month
+		rtcBuffer[MSF_YEAR] = getChunk(aBits, MSF_YEAR_OFFSET, MSF_YEAR_BITS);				// year	(offset, number of bits to read)
+#endif
+		TimeTime = makeTime();											// make a time_t compatible for Time/RTC library use
+		RxSecs = bitPointer + 1;										// number of seconds received
+#if MSF_FEATURES & MSF_FEATURE_BST
+		Bst = getChunk(bBits, MSF_BST_BIT_POS, 1);						//BST = 1, GMT = 0
+		BstSoon = getChunk(bBits, MSF_BSTSOON_BIT_POS, 1);				// BST imminent = 1
+#endif
+#if MSF_FEATURES & MSF_FEATURE_DUT
+		// DUT1 is counted from the start of the minute, bits 1-8 positive and 9-16 negative
+		DutPos = __builtin_popcount(getChunk(bBits, bitPointer - MSF_DUTPOS_POS, MSF_DUT_BITS)) * 100;
+		DutNeg = __builtin_popcount(getChunk(bBits, bitPointer - MSF_DUTNEG_POS, MSF_DUT_BITS)) * 100;
+#endif
+		timeIsSet = true;												// set flag for next start of minute
+		markerStart = secondStart;
+#if MSF_STATS
+		stats.minutesDecoded++;
+#endif
+	}
+#if MSF_STATS
+	statsTime(stats.minute, timeSource() - decodeStart);
+#endif
+	}
+  }
+}// End of "processEdge" decode routine
+
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+void MsfTimeLib::callSecond(uint32_t _time, bool _start)
+{
+// The seconds are numbered by the time since the START pulse edge, so a lost or extra pulse does not
+// put the numbers out. A pulse further than MSF_SOFT_EDGE_WINDOW ms from a whole second after it, or
+// in a second that has been given already, is not the start of a second and is not given.
+
+	if(_start)
+	{
+		secondEdge = _time;
+		secondNumber = 0;
+		secondCallback(0, _time);
+		return;
+	}
+	if(secondNumber == MSF_SECOND_UNKNOWN)
+	{
+		secondCallback(MSF_SECOND_UNKNOWN, _time);
+		return;
+	}
+	uint8_t second = secondNumber;
+	uint32_t edge = secondEdge;
+	while(_time - edge >= 500000UL && second <= 60)
+	{
+		edge += 1000000UL;
+		second++;
+	}
+	if(second > 60)
+	{
+		secondNumber = MSF_SECOND_UNKNOWN;		// the START pulse was missed
+		secondCallback(MSF_SECOND_UNKNOWN, _time);
+		return;
+	}
+	int32_t error = (int32_t)(_time - edge);
+	if(second == secondNumber || error > MSF_SOFT_EDGE_WINDOW * 1000L || error < -MSF_SOFT_EDGE_WINDOW * 1000L) return;
+	secondNumber = second;
+	secondEdge = edge;
+	secondCallback(second, _time);
+}
+#endif
+
+#if MSF_QUALITY
+void MsfTimeLib::qualityPulse(uint32_t _start, uint32_t _length, bool _second)
+{
+// Each usable pulse adds how far its length is from the nominal one, the mean of that is the receiver
+// offset and the mean distance from nominal + offset is the pulse error. At the start of each second
+// the seconds since the last one without a pulse of their own count as missing and the glitches and
+// unusable pulses in between are added. The averages move 1/2^MSF_QUALITY_SHIFT of the way each time,
+// the same few sums every second whatever the signal.
+
+	int16_t error = _length / 1000 - (pulseLength == 5 ? 500 : pulseLength * 100);
+	error = constrain(error, -100, 100);
+	qualityOffset += error - (qualityOffset >> MSF_QUALITY_SHIFT);
+	error -= qualityOffset >> MSF_QUALITY_SHIFT;
+	qualityError += (error < 0 ? -error : error) - (qualityError >> MSF_QUALITY_SHIFT);
+	if(!_second) return;
+
+	uint32_t period = pllPeriod >> 8;
+	uint32_t seconds = (_start - qualityEdge + period / 2) / period;
+	if(!seconds) return;						// a second pulse at the start of the same second
+	if(seconds > 16) seconds = 16;				// the average is all missing by then
+	while(--seconds) qualityMissing += 100 - (qualityMissing >> MSF_QUALITY_SHIFT);
+	qualityMissing -= qualityMissing >> MSF_QUALITY_SHIFT;
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+	int16_t glitches = (uint16_t)(GlitchPulses + GlitchGaps - qualityCount);	// a spike that became a gap counts -1
+	glitches = (glitches < 0 ? 0 : glitches) + qualityBad;
+	qualityCount = GlitchPulses + GlitchGaps;
+#else
+	int16_t glitches = qualityBad;
+#endif
+	qualityGlitches += (glitches > 10 ? 10 : glitches) * 60 - (qualityGlitches >> MSF_QUALITY_SHIFT);
+	qualityBad = 0;
+	qualityEdge = _start;
+}
+
+// The score takes points off 100 for each part: a pulse error of 30ms, 20ms of jitter, half of the
+// seconds missing or 30 glitches a minute each take off about 60, with the weights measured on the
+// msf_replay noise sweep. The seconds since the last one received count as missing, so a receiver
+// that has stopped goes to 0 within a few seconds even though the decoder has not run
+uint8_t MsfTimeLib::getQuality(MsfQuality &_quality)
+{
+	noInterrupts();
+	uint16_t missing = qualityMissing;
+	uint32_t silent = (timeSource() - qualityEdge) / (pllPeriod >> 8);
+	uint16_t pulseError = qualityError >> MSF_QUALITY_SHIFT;
+	uint16_t glitches = qualityGlitches >> MSF_QUALITY_SHIFT;
+	_quality.offset = qualityOffset >> MSF_QUALITY_SHIFT;
+	uint32_t variance = pllVariance;
+	bool locked = pllGear;
+	interrupts();
+	for(uint8_t s = 1; s < silent && s <= 16; s++) missing += 100 - (missing >> MSF_QUALITY_SHIFT);
+	_quality.pulseError = pulseError > 0xFF ? 0xFF : pulseError;
+	_quality.glitches = glitches > 0xFF ? 0xFF : glitches;
+	_quality.missing = missing >> MSF_QUALITY_SHIFT;
+	_quality.jitter = locked ? isqrt(variance) : 0xFFFF;
+	uint16_t penalty = _quality.pulseError * 2 + (locked ? _quality.jitter / 333 : 60) + _quality.missing * 6 / 5 +
+		_quality.glitches * 2;
+	_quality.score = penalty >= 100 ? 0 : 100 - penalty;
+	return _quality.score;
+}
+#endif
+
+#if MSF_VOTE_DEPTH
+void MsfTimeLib::softEdge(uint32_t _time, bool _off)
+{
+// The voting decoder keeps its own second and minute timing. Each second starts with the carrier OFF
+// edge that comes within MSF_SOFT_EDGE_WINDOW ms of the expected time, a second without one starts
+// 1000ms after the last. The minute is found from the 500ms START pulse and then counted on so a
+// missed START pulse does not lose it. For each second the time the carrier is OFF inside the 'A'
+// and 'B' windows gives a soft bit from -100 to +100.
+
+	if(softSecond >= 0)
+	{
+		if(_time - softSecondStart > 120000000UL)
+		{
+			softSecond = -1;					// no edges for minutes (receiver off?), start again
+			softMinutes = 0;
+			softGeneration++;
+		}
+		while(softSecond >= 0 && _time - softSecondStart >= (1000 + MSF_SOFT_EDGE_WINDOW) * 1000UL)
+		{
+			softNextSecond(softSecondStart + 1000000UL, false);	// a second without a pulse
+		}
+	}
+	if(_off)
+	{
+		if(softSecond >= 0 && _time - softSecondStart >= (1000 - MSF_SOFT_EDGE_WINDOW) * 1000UL) softNextSecond(_time, true);
+		softOffStart = _time;
+		return;
+	}
+	uint32_t width = _time - softOffStart;
+	if(width >= 400000UL && width < 700000UL)
+	{
+		// a START pulse. Where it is expected it confirms the timing, anywhere else the timing was
+		// wrong (or there was a leap second) and the minutes so far can not be combined with the next
+		if(softSecond != 0 || softSecondStart != softOffStart)
+		{
+			softSecond = 0;
+			softSecondStart = softOffStart;
+			softMinutes = 0;
+			softGeneration++;
+			memset(&softFrames[softNewest], 0, sizeof(MsfSoftFrame));
+		}
+		softOffA = softOffB = 0;
+		softAnchored = true;
+		return;
+	}
+	if(softSecond < 0) return;
+	int32_t from = (int32_t)(softOffStart - softSecondStart);
+	int32_t to = from + (int32_t)width + padding * 1000L;
+	softOffA += softOverlap(from, to, MSF_SOFT_A_WINDOW);
+	softOffB += softOverlap(from, to, MSF_SOFT_B_WINDOW);
+}
+
+void MsfTimeLib::softNextSecond(uint32_t _start, bool _edge)
+{
+	// a second without a carrier OFF edge at its start was not received at all, its bits stay 0
+	MsfSoftFrame &frame = softFrames[softNewest];
+	uint8_t offA = softOffA, offB = softOffB;
+#if MSF_SAMPLED
+	if(sampled)
+	{
+		offA = sampleOffA;						// measured by feedSample()
+		offB = sampleOffB;
+	}
+#endif
+	if(softAnchored)
+	{
+		if(softSecond >= 17 && softSecond <= 51) frame.a[softSecond - 17] = softBit(offA);
+		else if(softSecond >= 53 && softSecond <= 58) frame.b[softSecond - 53] = softBit(offB);
+	}
+	softOffA = softOffB = 0;
+	softAnchored = _edge;
+	softSecondStart = _start;
+	if(++softSecond < 60) return;
+
+	// a new minute: vote on the minutes so far. If the normal decoder has a time the Confidence
+	// only stands if the vote agrees with it. Otherwise the voted time is given out when the
+	// minute starts with an edge, as for the normal decoder TimeAvailable is set by this edge,
+	// unless the normal decoder has given that minute already (a spike late in second 59)
+	softSecond = 0;
+	if(softMinutes < MSF_VOTE_DEPTH) softMinutes++;
+	const MsfSoftFrame * minutes[MSF_VOTE_DEPTH];
+	uint8_t age[MSF_VOTE_DEPTH];
+	for(uint8_t i = 0; i < softMinutes; i++)
+	{
+		minutes[i] = &softFrames[(softNewest + MSF_VOTE_DEPTH - i) % MSF_VOTE_DEPTH];
+		age[i] = i;
+	}
+	uint8_t rtc[7];
+	bool bst, bstSoon;
+	Confidence = vote(minutes, age, softMinutes, rtc, bst, bstSoon);
+	if(timeIsSet)
+	{
+		if(toTimeT(rtc) != TimeTime) Confidence = 0;
+	}
+	else if(_edge && Confidence >= MSF_VOTE_MIN_CONFIDENCE && toTimeT(rtc) != TimeTime)
+	{
+		for(uint8_t x = 0; x < 7; x++) rtcBuffer[x] = rtc[x];
+		TimeTime = toTimeT(rtc);
+#if MSF_FEATURES & MSF_FEATURE_BST
+		Bst = bst;
+		BstSoon = bstSoon;
+#endif
+		LeapSecond = 0;
+		RxSecs = 60;
+		timeIsSet = true;
+		markerStart = _start - 1000000UL;
+	}
+	softNewest = (softNewest + 1) % MSF_VOTE_DEPTH;
+	memset(&softFrames[softNewest], 0, sizeof(MsfSoftFrame));
+	softGeneration++;
+}
+
+uint8_t MsfTimeLib::vote(const MsfSoftFrame * const * _frame, const uint8_t * _age, uint8_t _count,
+	uint8_t * _rtc, bool &_bst, bool &_bstSoon)
+{
+// Minute i before the newest carries the newest time less i minutes. The minute is found by trying
+// all 60 values against the minute bits of every frame. The other fields do not change within the
+// hour so their soft bits are added up over the minutes of this hour and each parity group is decoded
+// on its own. The Confidence is the smallest margin between the choice made and the next best one, a
+// single clean minute gives 100. The fields must make a real date with the right weekday. Frames of
+// the same minute from other receivers (MsfDiversity) simply add to the sums.
+
+	uint8_t minuteBcd[MSF_VOTE_DEPTH];
+	for(uint8_t i = 0; i < MSF_VOTE_DEPTH; i++) minuteBcd[i] = decToBcd((60 - i) % 60);	// the minute i before the newest (0)
+	int16_t best = -0x7FFF, next = -0x7FFF;
+	uint8_t minute = 0;
+	for(uint8_t m = 0; m < 60; m++)
+	{
+		int16_t score = 0;
+		for(uint8_t i = 0; i < _count; i++) score += softMatch(&_frame[i]->a[SOFT_MINUTE], minuteBcd[_age[i]], MSF_MINUTE_BITS);
+		for(uint8_t i = 0; i < MSF_VOTE_DEPTH; i++) minuteBcd[i] = bcdNextMinute(minuteBcd[i]);
+		if(score > best)
+		{
+			next = best;
+			best = score;
+			minute = m;
+		}
+		else if(score > next) next = score;
+	}
+	int16_t margin = best - next;
 
-static  const uint8_t monthDays[]={31,28,31,30,31,30,31,31,30,31,30,31}; // API starts months from 1, this array starts from 0
+	// the minutes of this hour
+	int16_t sum[SOFT_SUMS];
+	int16_t parity[4] = {0, 0, 0, 0};
+	int16_t bst = 0, bstSoon = 0;
+	memset(sum, 0, sizeof(sum));
+	for(uint8_t i = 0; i < _count; i++)
+	{
+		const MsfSoftFrame *f = _frame[i];
+		if(_age[i] > minute) continue;
+		for(uint8_t j = 0; j < SOFT_SUMS; j++) sum[j] += f->a[j];
+		for(uint8_t g = 0; g < 3; g++) parity[g] += f->b[g + 1];
+		// the hour + minute parity bit without the minute bits, which are known
+		parity[3] += __builtin_parity(decToBcd(minute - _age[i])) ? -f->b[4] : f->b[4];
+		bstSoon += f->b[0];
+		bst += f->b[5];
+	}
+	_rtc[MSF_SECOND] = 0;
+	_rtc[MSF_MINUTE] = decToBcd(minute);
+	_rtc[MSF_HOUR] = softGroup(&sum[SOFT_HOUR], MSF_HOUR_BITS, parity[3], margin);
+	_rtc[MSF_DAY] = softGroup(&sum[SOFT_WEEKDAY], MSF_WEEKDAY_BITS, parity[2], margin);
+	uint16_t monthDate = softGroup(&sum[SOFT_MONTH], MSF_MONTH_PARITY_BITS, parity[1], margin);
+	_rtc[MSF_DATE] = monthDate & 0x3F;
+	_rtc[MSF_MONTH] = monthDate >> MSF_DATE_BITS;
+	_rtc[MSF_YEAR] = softGroup(&sum[SOFT_YEAR], MSF_YEAR_BITS, parity[0], margin);
+	_bst = bst > 0;
+	_bstSoon = bstSoon > 0;
 
-time_t MsfTimeLib::makeTime()
-{   
-// this function was borrowed and modified from the Time library by Michael Margolis
-// note year argument is offset from 1970 (see macros in Time.h to convert to other formats)
-// previous version used full four digit year (or digits since 2000),i.e. 2009 was 2009 or 9
-  
-	int16_t i;
-	uint32_t seconds;
-	uint8_t Year = bcdToDec(rtcBuffer[MSF_YEAR]);	//decYear;
-	uint8_t Month = bcdToDec(rtcBuffer[MSF_MONTH]);
-	uint8_t Date = bcdToDec(rtcBuffer[MSF_DATE]);
-	uint8_t Hour = bcdToDec(rtcBuffer[MSF_HOUR]);
-	uint8_t Minute = bcdToDec(rtcBuffer[MSF_MINUTE]);
-  
-	if(Year > 99) Year = Year - 1970;
-	else Year += 30;
+	uint8_t check[7];
+	if(!fromTimeT(toTimeT(_rtc), check)) return 0;
+	for(uint8_t x = MSF_MINUTE; x <= MSF_YEAR; x++) if(check[x] != _rtc[x]) return 0;
+	return margin >= 200 ? 100 : margin / 2;
+}
+#endif
+
+#if MSF_TRACK_RUN
+void MsfTimeLib::trackFix(uint32_t _start, bool _late)
+{
+	// a fix gives the minute that starts at _start. A late one (the START pulse was lost) only has the
+	// edge from the PLL, without that tracking goes on as it was. The hour changes when BST starts or
+	// ends so nothing is tracked while BstSoon is set. A wrong fix would be tracked on for as long as
+	// the seconds that match miss its wrong bits, so no time is given until a fix agrees with the
+	// minutes tracked from the one before or a whole tracked minute has no second that does not match
+	uint32_t start = _start, error;
+	if(fixBuffer.bstSoon)
+	{
+		trackTime = 0;
+		return;
+	}
+	if(_late && !pllSecond(_start, start, error)) return;
+	int32_t elapsed = start - trackEdge;
+	uint32_t period = pllPeriod >> 8;
+	trackTrusted = trackTime && elapsed >= -MSF_TRACK_WINDOW * 1000L && elapsed <= (int32_t)(MSF_TRACK_COAST * 1000000UL) &&
+		fixBuffer.time == trackTime + trackSecond + (elapsed + (int32_t)period / 2) / (int32_t)period;
+	trackTime = fixBuffer.time;
+	trackEdge = start;
+	trackSecond = 0;
+	trackSeen = -1;
+	trackPending = trackConfirmed = false;
+	trackRun = trackMatched = trackMissed = trackData = 0;
+	trackPredict();
+}
+
+bool MsfTimeLib::trackPredict(void)
+{
+	// the minute being tracked carries the time at the start of the next one, in the same bits as
+	// MsfSignalGen sends them. BST is as the last fix, BST imminent is never set
+	uint8_t rtc[7];
+	if(!fromTimeT(trackTime + 60, rtc))
+	{
+		trackTime = 0;							// after 2099, there is nothing to predict
+		return false;
+	}
+	uint8_t value[7] = {rtc[MSF_YEAR], rtc[MSF_MONTH], rtc[MSF_DATE], rtc[MSF_DAY], rtc[MSF_HOUR], rtc[MSF_MINUTE], MSF_MARKER};
+	memset(trackA, 0, sizeof(trackA));
+	memset(trackB, 0, sizeof(trackB));
+	uint8_t second = 17;
+	for(uint8_t f = 0; f < 7; f++)
+	{
+		for(int8_t i = pgm_read_byte(&trackWidths[f]) - 1; i >= 0; i--, second++)
+		{
+			if(bitRead(value[f], i)) bitSet(trackA[second >> 3], second & 0x07);
+		}
+	}
+	// odd parity over year, month + date, weekday and hour + minute in seconds 54 - 57
+	uint16_t group[4] = {rtc[MSF_YEAR], (uint16_t)(rtc[MSF_MONTH] << MSF_DATE_BITS | rtc[MSF_DATE]), rtc[MSF_DAY],
+		(uint16_t)(rtc[MSF_HOUR] << MSF_MINUTE_BITS | rtc[MSF_MINUTE])};
+	for(uint8_t g = 0; g < 4; g++)
+	{
+		if(!__builtin_parity(group[g])) bitSet(trackB[(54 + g) >> 3], (54 + g) & 0x07);
+	}
+	if(fixBuffer.bst) bitSet(trackB[58 >> 3], 58 & 0x07);
+	return true;
+}
+
+void MsfTimeLib::trackPulse(uint32_t _time, uint8_t _bits, bool _replace)
+{
+// The second of a pulse is counted from the last second that matched with the PLL period, its carrier
+// OFF edge must be within MSF_TRACK_WINDOW of a whole second after it. A second is compared when the
+// next one starts as a 'B' only pulse replaces the bits of its first part. A START pulse a second early
+// or late (a leap second) moves the count, anywhere else it does not match. Nothing has matched for
+// MSF_TRACK_COAST seconds: tracking stops until the next fix.
+
+	if(_replace)
+	{
+		if(trackPending) trackBits = _bits;
+		return;
+	}
+	int32_t elapsed = _time - trackEdge;
+	if(elapsed < -MSF_TRACK_WINDOW * 1000L) return;
+	if(elapsed > (int32_t)(MSF_TRACK_COAST * 1000000UL))
+	{
+		trackTime = 0;
+		return;
+	}
+	uint32_t period = pllPeriod >> 8;
+	uint16_t seconds = ((uint32_t)elapsed + period / 2) / period;
+	int32_t offset = elapsed - (int32_t)(seconds * period);
+	if(offset > MSF_TRACK_WINDOW * 1000L || offset < -MSF_TRACK_WINDOW * 1000L) return;	// not the start of a second
+	int16_t second = trackSecond + seconds;
+	if(_bits == MSF_TRACK_START)
+	{
+		int8_t slip = (second + 1) % 60 - 1;	// -1, 0 or 1 at the start of a minute
+		if(slip == 1 || slip == -1)
+		{
+			trackSecond -= slip;
+			second -= slip;
+			trackSeen = -1;
+			trackPending = false;
+		}
+	}
+	if(second >= 60)
+	{
+		// the next minute, the minute before is finished with
+		if(trackPending) trackCompare();
+		while(second >= 60)
+		{
+			second -= 60;
+			trackSecond -= 60;
+			trackTime += 60;
+		}
+		if(!trackPredict()) return;
+		trackSeen = -1;
+		trackRun = trackMatched = trackMissed = trackData = 0;
+		trackConfirmed = false;
+	}
+	if(second <= trackSeen) return;				// another pulse in a second already taken
+	if(trackPending) trackCompare();
+	if(second != trackSeen + 1) trackRun = 0;	// seconds were lost
+	trackSeen = second;
+	trackPendingEdge = _time;
+	trackBits = _bits;
+	trackPending = true;
+}
+
+void MsfTimeLib::trackCompare(void)
+{
+	// seconds 1 - 16 carry DUT1 in the 'B' bits, which is not predicted, and always match the seconds
+	// before and after them so they are not counted towards MSF_TRACK_RUN
+	trackPending = false;
+	bool match;
+	if(!trackSeen) match = trackBits == MSF_TRACK_START;
+	else
+	{
+		uint8_t expected = bitRead(trackA[trackSeen >> 3], trackSeen & 0x07) | bitRead(trackB[trackSeen >> 3], trackSeen & 0x07) << 1;
+		match = trackSeen <= 16 ? (trackBits & 0x01) == (expected & 0x01) : trackBits == expected;
+	}
+	if(!match)
+	{
+		if(trackSeen > 16) trackMissed++;
+		trackRun = 0;
+		return;
+	}
+	trackEdge = trackPendingEdge;
+	trackSecond = trackSeen;
+	trackMatched++;
+	if(trackSeen > 16) trackData++;
+	if(++trackRun >= MSF_TRACK_RUN && trackSeen >= 16 + MSF_TRACK_RUN) trackConfirmed = true;
+}
+
+bool MsfTimeLib::trackEnd(uint32_t _time)
+{
+	// the minute after the one being tracked starts a whole number of seconds after the last match
+	int32_t elapsed = _time - trackEdge;
+	uint32_t period = pllPeriod >> 8;
+	if(elapsed < 0 || elapsed > (int32_t)(MSF_TRACK_COAST * 1000000UL)) return false;
+	uint16_t seconds = ((uint32_t)elapsed + period / 2) / period;
+	int32_t offset = elapsed - (int32_t)(seconds * period);
+	if(trackSecond + seconds != 60 || offset > MSF_TRACK_WINDOW * 1000L || offset < -MSF_TRACK_WINDOW * 1000L) return false;
+	if(trackPending) trackCompare();			// second 59
+	if(!trackMissed && trackData >= MSF_TRACK_VERIFY) trackTrusted = true;
+	if(!trackConfirmed || !trackTrusted) return false;
+	trackConfirmed = false;
+	fromTimeT(trackTime + 60, rtcBuffer);
+	TimeTime = trackTime + 60;
+#if MSF_FEATURES & MSF_FEATURE_BST
+	Bst = fixBuffer.bst;						// DUT1 stays as it was
+	BstSoon = false;
+#endif
+	LeapSecond = 0;
+	RxSecs = trackMatched;
+	ParityResult = 0;							// not the failed parity of the lost minute
+	Confidence = MSF_TRACK_CONFIDENCE;
+	TrackedMinutes++;
+	return true;
+}
+#endif
+
+#if MSF_AUTO_BINS
+uint8_t MsfTimeLib::pulseClassify(uint32_t _length)
+{
+	// the pulse length code as the fixed padding gives it: 1, 2, 3 or 5 for 100 - 500ms, 0 = too short
+	// and 6 = too long. The bins are centred on multiples of MSF_AUTO_BIN so a clean 100ms pulse is in
+	// the middle of bin 100 / MSF_AUTO_BIN. Pulses shorter than two bins are spikes and not counted
+	uint16_t ms = _length / 1000UL;
+	uint16_t bin = (ms + MSF_AUTO_BIN / 2) / MSF_AUTO_BIN;
+	if(bin >= 2 && bin < MSF_AUTO_BINS && ++pulseHist[bin] == 255)
+	{
+		for(uint8_t i = 0; i < MSF_AUTO_BINS; i++) pulseHist[i] >>= 1;	// halve the old counts
+	}
+	if(++histPulses >= 16) pulseCalibrate();
+	if(ms < pulseThreshold[0]) return 0;
+	if(ms < pulseThreshold[1]) return 1;
+	if(ms < pulseThreshold[2]) return 2;
+	if(ms < pulseThreshold[3]) return 3;
+	if(ms < pulseThreshold[4]) return 5;
+	return 6;
+}
+
+void MsfTimeLib::pulseCalibrate(void)
+{
+// The receiver lengthens (or shortens) every carrier OFF pulse by about the same time so the pulses
+// form clusters at 100, 200, 300 and 500ms plus that offset. The offset is first found to the nearest
+// bin as the one that puts the most pulses into the four clusters, then the centre of each cluster is
+// the mean of the bins around it. The thresholds are half way between the centres and the offset
+// (the mean of the clusters) sets the padding for the voting decoder.
+
+	static const uint16_t nominal[4] = { 100, 200, 300, 500 };
+	const int8_t range = MSF_AUTO_RANGE / MSF_AUTO_BIN;
+	histPulses = 0;
+	int8_t best = 0;
+	int16_t bestCount = 0;
+	for(int8_t o = -range; o <= range; o++)
+	{
+		// the pulses half way between the clusters count against an offset, otherwise one of about
+		// 50ms too short or too long fits almost as well as the right one
+		int16_t count = 0;
+		for(uint8_t k = 0; k < 4; k++)
+		{
+			int16_t bin = nominal[k] / MSF_AUTO_BIN + o;
+			int16_t gap = k < 3 ? bin + (nominal[k + 1] - nominal[k]) / (2 * MSF_AUTO_BIN) : -2;
+			for(int8_t d = -1; d <= 1; d++)
+			{
+				if(bin + d >= 0 && bin + d < MSF_AUTO_BINS) count += pulseHist[bin + d];
+				if(gap + d >= 0 && gap + d < MSF_AUTO_BINS) count -= pulseHist[gap + d];
+			}
+		}
+		if(count > bestCount)
+		{
+			bestCount = count;
+			best = o;
+		}
+	}
+	uint16_t centre[4];
+	uint16_t count[4];
+	uint16_t total = 0;
+	int32_t offsetSum = 0;
+	for(uint8_t k = 0; k < 4; k++)
+	{
+		int16_t bin = nominal[k] / MSF_AUTO_BIN + best;
+		uint32_t sum = 0;
+		count[k] = 0;
+		for(int16_t b = bin - 3; b <= bin + 3; b++)
+		{
+			if(b < 0 || b >= MSF_AUTO_BINS) continue;
+			count[k] += pulseHist[b];
+			sum += (uint32_t)pulseHist[b] * b * MSF_AUTO_BIN;
+		}
+		centre[k] = count[k] ? sum / count[k] : nominal[k];
+		total += count[k];
+		offsetSum += (int32_t)count[k] * ((int16_t)centre[k] - (int16_t)nominal[k]);
+	}
+	if(total >= MSF_AUTO_MIN_PULSES) rxOffset = offsetSum / total;
+	for(uint8_t k = 0; k < 4; k++)
+	{
+		// until there are enough pulses the nominal lengths are used, a cluster with hardly any
+		// pulses in it (300 and 500ms pulses are rare) is put where the offset says
+		if(total < MSF_AUTO_MIN_PULSES) centre[k] = nominal[k];
+		else if(count[k] < 4) centre[k] = nominal[k] + rxOffset;
+	}
+	pulseThreshold[0] = centre[0] > 50 ? centre[0] - 50 : 0;
+	pulseThreshold[1] = (centre[0] + centre[1]) / 2;
+	pulseThreshold[2] = (centre[1] + centre[2]) / 2;
+	pulseThreshold[3] = (centre[2] + centre[3]) / 2;
+	pulseThreshold[4] = centre[3] + 100;
+	// the padding for the voting decoder puts the middle of its 'A' window half way between the
+	// ends of a "0" and a "1"
+	padding = MSF_SOFT_A_WINDOW + MSF_SOFT_WINDOW_LEN / 2 - 150 - rxOffset;
+}
+#endif
+
+// the ms the receiver lengthens the carrier OFF pulses by. Measured with MSF_PAD_AUTO, otherwise the
+// padding given to begin() is assumed to make up for it
+int8_t MsfTimeLib::pulseOffset(void)
+{
+#if MSF_AUTO_BINS
+	if(autoPad) return rxOffset;
+#endif
+	return -padding;
+}
+
+#if MSF_FEATURES & MSF_FEATURE_PLL
+void MsfTimeLib::pllEdge(uint32_t _time)
+{
+// A second order (alpha-beta) PLL follows the start of the MSF seconds. Each carrier OFF edge at the start
+// of a second is compared with the prediction, the phase is moved by 1/2^gear of the error and the period
+// by 1/2^(2 * gear + 1) of it. The gear goes up after 4 << gear edges in a row so the lock is fast at first
+// and the jitter of the edges is averaged over more and more seconds. Edges further than MSF_PLL_WINDOW
+// from the prediction are not used, nor from gear 3 on those further than 4 standard deviations (but
+// at least 2ms) which keeps spurious pulses out. The phase and the period are kept in 1/256 us and the
+// period remembers the part of the error too small to move it, so the loop settles without a dead band.
+// When no edge has been used for MSF_PLL_HOLD seconds the lock is dropped, a new lock needs two edges
+// one or two seconds apart.
+
+	pllCoastTo(_time);
+	if(!pllGear)
+	{
+		// pllEpoch is the candidate edge when pllCount is set
+		uint32_t period = pllPeriod >> 8;
+		uint32_t seconds = (_time - pllEpoch + period / 2) / period;
+		int32_t error = _time - (pllEpoch + seconds * period);
+		if(pllCount && seconds >= 1 && seconds <= 2 && error <= MSF_PLL_WINDOW && error >= -MSF_PLL_WINDOW)
+		{
+			pllEpoch = _time;
+			pllFraction = 0;
+			pllVariance = (uint32_t)MSF_PLL_WINDOW * MSF_PLL_WINDOW / 4;
+			pllGear = 1;
+			pllCount = 0;
+			pllCoast = 0;
+			pllCoastAt = _time;
+			return;
+		}
+	}
+	else
+	{
+		uint32_t period = pllPeriod >> 8;
+		uint32_t seconds = (_time - pllEpoch + period / 2) / period;
+		if(seconds <= MSF_PLL_HOLD)
+		{
+			uint32_t fraction = pllFraction + seconds * (pllPeriod & 0xFF);	// 1/256 us
+			uint32_t predicted = pllEpoch + seconds * period + (fraction >> 8);
+			int32_t error = _time - predicted;
+			uint32_t square = (uint32_t)error * (uint32_t)error;	// wraps for errors over 65ms, they are outside
+			bool inside = error <= MSF_PLL_WINDOW && error >= -MSF_PLL_WINDOW;
+			if(pllGear >= 3 && square > 4000000UL && square / 16 > pllVariance) inside = false;
+			if(seconds && inside)				// not a second edge in the same second
+			{
+				// in 1/256 us so that the small errors of a high gear still move it
+				int32_t error256 = error * 256L - (int32_t)(fraction & 0xFF);
+				int32_t move = (int32_t)(fraction & 0xFF) + (error256 >> pllGear);
+				pllEpoch = predicted + (move >> 8);
+				pllFraction = move & 0xFF;
+				int32_t step = error256 / (int32_t)seconds + (int32_t)pllRest;
+				pllPeriod += step >> (2 * pllGear + 1);
+				pllRest = step & ((1UL << (2 * pllGear + 1)) - 1);
+				pllVariance = pllVariance - (pllVariance >> 4) + (square >> 4);
+				pllCoast = 0;
+				pllCoastAt = pllEpoch;
+				if(++pllCount >= (4 << pllGear) && pllGear < MSF_PLL_GEARS)
+				{
+					pllGear++;
+					pllCount = 0;
+				}
+				return;
+			}
+			return;								// a stray edge, keep the lock
+		}
+	}
+	// no lock, this edge is the candidate for a new one, the period is kept
+	pllEpoch = _time;
+	pllFraction = 0;
+	pllGear = 0;
+	pllCount = 1;
+	pllCoast = 0;
+	pllCoastAt = _time;
+}
+
+void MsfTimeLib::pllCoastTo(uint32_t _time)
+{
+	// The seconds since pllEpoch are counted as they pass and the lock is dropped after MSF_PLL_COAST of
+	// them, so the sums that take _time - pllEpoch never see a difference that has wrapped (71.6 minutes
+	// of micros()). The count must be brought up to date, by an edge or a call of secondEpochMicros() or
+	// uncertaintyMicros(), at least once an hour. Called with interrupts off.
+	uint32_t period = pllPeriod >> 8;
+	uint32_t elapsed = _time - pllCoastAt;
+	if(elapsed >= period && elapsed <= -period)		// not the same second nor just before it
+	{
+		uint32_t seconds = elapsed / period;
+		pllCoastAt += seconds * period;
+		pllCoast = seconds > 255U - pllCoast ? 255 : pllCoast + seconds;
+	}
+	if(pllCoast > MSF_PLL_COAST)
+	{
+		pllGear = 0;
+		pllCount = 0;
+	}
+	if(!pllGear && !pllCount)
+	{
+		pllEpoch = pllCoastAt;				// no lock, keep secondEpochMicros() near
+		pllFraction = 0;
+	}
+}
+
+bool MsfTimeLib::pllSecond(uint32_t _time, uint32_t &_start, uint32_t &_error)
+{
+	// the same sums as secondEpochMicros() and uncertaintyMicros() for the second nearest _time
+	pllCoastTo(_time);
+	if(pllGear < 2) return false;
+	uint32_t period = pllPeriod >> 8;
+	uint32_t seconds = (_time - pllEpoch + period / 2) / period;
+	if(seconds > MSF_PLL_COAST) return false;
+	_start = pllEpoch + seconds * period + ((pllFraction + seconds * (pllPeriod & 0xFF)) >> 8);
+	int32_t offset = _time - _start;
+	if(offset > MSF_PLL_WINDOW || offset < -MSF_PLL_WINDOW) return false;
+	_error = (((uint32_t)isqrt(pllVariance) * (pgm_read_byte(&pllPhaseK[pllGear - 1]) + seconds * pgm_read_byte(&pllPeriodK[pllGear - 1]))) >> 8) + 1;
+	return true;
+}
+
+uint32_t MsfTimeLib::secondEpochMicros(void)
+{
+	// the time source value at the start of the current MSF second, corrected for the receiver delay
+	noInterrupts();
+	uint32_t now = timeSource();
+	pllCoastTo(now);
+	uint32_t epoch = pllEpoch;
+	uint8_t fraction = pllFraction;
+	uint32_t period = pllPeriod;
+	interrupts();
+	uint32_t seconds = (now - epoch) / (period >> 8);
+	return epoch + seconds * (period >> 8) + ((fraction + seconds * (period & 0xFF)) >> 8) - MSF_RX_DELAY_US;
+}
+
+uint32_t MsfTimeLib::nowMicros(void)
+{
+	// the time source us since the start of the second scaled to MSF us by the measured period
+	uint32_t epoch = secondEpochMicros();
+	uint32_t elapsed = timeSource() - epoch;
+	uint32_t us = elapsed * (256000000.0f / pllPeriod);
+	return us > 999999UL ? 999999UL : us;
+}
+
+uint16_t MsfTimeLib::uncertaintyMicros(void)
+{
+	// the PLL error from the jitter of the edges it has seen, growing with each second without one
+	noInterrupts();
+	uint32_t now = timeSource();
+	pllCoastTo(now);
+	uint8_t gear = pllGear;
+	uint32_t variance = pllVariance;
+	uint32_t seconds = (now - pllEpoch) / (pllPeriod >> 8);
+	interrupts();
+	if(gear < 2 || seconds > MSF_PLL_COAST) return 0xFFFF;	// gear 1 may still be locked on noise
+	uint32_t sigma = isqrt(variance);
+	uint32_t error = (sigma * (pgm_read_byte(&pllPhaseK[gear - 1]) + seconds * pgm_read_byte(&pllPeriodK[gear - 1]))) >> 8;
+	error++;							// the time source counts whole us
+	return error > 0xFFFE ? 0xFFFE : error;
+}
+#endif
+
+/* Everything beyond this point is for decoding and parity checking */
+
+void MsfTimeLib::publishFix(uint32_t _start, bool _late)
+{
+#if !(MSF_FEATURES & MSF_FEATURE_HOLD)
+	(void)_start;								// only the fix and the holdover clock need them
+	(void)_late;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_FIX
+	// the write side of a sequence lock: readers see fixSequence odd while the fields change
+	fixSequence++;
+	MSF_BARRIER();
+	fixBuffer.generation++;
+	fixBuffer.startMicros = _start;
+	fixBuffer.time = TimeTime;
+	for(uint8_t x = 0; x < 7; x++) fixBuffer.rtc[x] = rtcBuffer[x];
+#if MSF_FEATURES & MSF_FEATURE_DUT
+	fixBuffer.dutPos = DutPos;
+	fixBuffer.dutNeg = DutNeg;
+#endif
+	fixBuffer.leapSecond = LeapSecond;
+#if MSF_FEATURES & MSF_FEATURE_BST
+	fixBuffer.bst = Bst;
+	fixBuffer.bstSoon = BstSoon;
+#endif
+	fixBuffer.parity = ParityResult;
+	fixBuffer.confidence = Confidence;
+	MSF_BARRIER();
+	fixSequence++;
+#endif
+#if MSF_FEATURES & MSF_FEATURE_HOLD
+	// the holdover clock runs on from here, from the PLL second if it has one as that is more exact
+	uint32_t start, error;
+#if MSF_FEATURES & MSF_FEATURE_PLL
+	if(!pllSecond(_start, start, error))
+#endif
+	{
+		start = _start;
+		error = _late ? MSF_HOLD_LATE_US : MSF_HOLD_EDGE_US;
+	}
+	holdMicros = start - MSF_RX_DELAY_US;
+#if MSF_FEATURES & MSF_FEATURE_BST
+	holdTime = Bst ? TimeTime - SECS_PER_HOUR : TimeTime;	// the clock runs in UTC
+#else
+	holdTime = TimeTime;
+#endif
+	holdError = error;
+	holdFixes++;
+	leapStep = 0;								// this fix is after it
+#endif
+#if MSF_TRACK_RUN
+	if(tracking) trackFix(_start, _late);
+#endif
+#if MSF_FEATURES & MSF_FEATURE_FIX
+	if(minuteCallback) minuteCallback(fixBuffer);
+#endif
+}
+
+#if MSF_FEATURES & MSF_FEATURE_FIX
+bool MsfTimeLib::getFix(MsfFix &_fix)
+{
+// The interrupt can write fixBuffer at any time, the copy is made again until the sequence count
+// was even (no write going on) and the same before and after it. Interrupts are never turned off
+// and the writer never waits, a write takes a few us so a second try is rare.
+
+	uint8_t sequence;
+	do
+	{
+		sequence = fixSequence;
+		MSF_BARRIER();
+		memcpy(&_fix, &fixBuffer, sizeof(MsfFix));
+		MSF_BARRIER();
+	} while((sequence & 0x01) || sequence != fixSequence);
+	return _fix.generation != 0;
+}
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_HOLD
+void MsfTimeLib::holdFix(uint32_t _anchor, time_t _time, uint32_t _error)
+{
+// The fixes are whole seconds apart, so the time source us between the base fix and this one less
+// the true us is how far the oscillator has run fast. The time source wraps every 71 minutes,
+// the whole wraps are put back from the true time between the fixes. A fix that does not fit the
+// base within MSF_HOLD_MAX_PPM (a wrong time or a restart), or is too far from it for the wraps
+// to be counted, becomes the new base. A measurement
+// over a shorter time only replaces a more certain one when that is older than MSF_HOLD_SPAN.
+
+	fixTime = _time;
+	fixError = _error;
+	if(!baseTime || _time <= baseTime || (uint32_t)(_time - baseTime) > 2 * MSF_HOLD_SPAN)
+	{
+		baseMicros = _anchor;
+		baseTime = _time;
+		baseError = _error;
+		return;
+	}
+	uint32_t span = _time - baseTime;
+	int64_t expected = span * 1000000LL;
+	int64_t local = (uint32_t)(_anchor - baseMicros);
+	local += ((expected - local + 0x80000000LL) >> 32) * 0x100000000LL;	// nearest number of wraps
+	int64_t fast = local - expected;
+	if((fast < 0 ? -fast : fast) > span * MSF_HOLD_MAX_PPM + 100000L)
+	{
+		baseMicros = _anchor;
+		baseTime = _time;
+		baseError = _error;
+		return;
+	}
+	if(span < MSF_HOLD_MIN_SPAN) return;
+	// both ends can be out by their error, twice that gives a safe bound
+	uint32_t error = (baseError + _error) * 2000UL / span + 1;
+	if(error <= holdPpbError || span >= MSF_HOLD_SPAN)
+	{
+		holdPpb = fast * 1000 / span;
+		holdPpbError = error;
+	}
+	if(span >= MSF_HOLD_SPAN)
+	{
+		baseMicros = _anchor;
+		baseTime = _time;
+		baseError = _error;
+	}
+}
+
+void MsfTimeLib::leapAhead(uint32_t _start, int8_t _step)
+{
+	// the second after the one that started at _start is put in (+1) or left out (-1), holdNow()
+	// checks that this is the end of a UTC month before it believes it
+	uint32_t start = _start;
+#if MSF_FEATURES & MSF_FEATURE_PLL
+	uint32_t error;
+	if(!pllSecond(_start, start, error)) start = _start;
+#endif
+	leapMicros = start + 1000000UL - MSF_RX_DELAY_US;
+	leapStep = _step;
+}
+
+void MsfTimeLib::utcFix(time_t _time)
+{
+// Once for each fix (at UTC _time): the offset of local time, the next change of it and the next
+// month end, so that now() and the rest only compare and add
+
+	MsfFix fix;
+	getFix(fix);
+	utcOffsetNow = fix.bst ? SECS_PER_HOUR : 0;
+	utcChange = 0;
+	if(fix.bstSoon)
+	{
+		// BstSoon is sent for the 61 minutes before the change at 01:00 UTC
+		utcChange = _time - _time % SECS_PER_DAY + SECS_PER_HOUR;
+		if(utcChange <= _time) utcChange += SECS_PER_DAY;
+	}
+	utcDut = (int16_t)fix.dutPos - (int16_t)fix.dutNeg;
+	uint8_t rtc[7];
+	utcMonthEnd = 0;
+	if(!fromTimeT(_time, rtc)) return;
+	// the minute before this fix had a leap second: the base fix is a second further (or nearer)
+	if(fix.leapSecond && rtc[MSF_DATE] == 1 && !(_time % SECS_PER_DAY) && baseTime) baseTime -= fix.leapSecond;
+	rtc[MSF_SECOND] = rtc[MSF_MINUTE] = rtc[MSF_HOUR] = 0;
+	rtc[MSF_DATE] = 1;
+	if(rtc[MSF_MONTH] == 0x12)
+	{
+		if(rtc[MSF_YEAR] == 0x99) return;			// 2100 is outside
+		rtc[MSF_MONTH] = 1;
+		rtc[MSF_YEAR] = decToBcd(bcdToDec(rtc[MSF_YEAR]) + 1);
+	}
+	else rtc[MSF_MONTH] = decToBcd(bcdToDec(rtc[MSF_MONTH]) + 1);
+	utcMonthEnd = toTimeT(rtc);
+}
+
+time_t MsfTimeLib::holdNow(uint32_t &_us)
+{
+// The time source us since the anchor are turned into true us with the measured oscillator error.
+// Before the time source can wrap under it the anchor is moved on by whole seconds, so now() must
+// be called at least once an hour while there are no fixes. A fix that comes while the anchor is
+// being moved wins. The clock runs in UTC and counts every second, a leap second found by the
+// decoder is taken into the anchor once it is over.
+
+	noInterrupts();
+	uint8_t fixes = holdFixes;
+	uint32_t anchor = holdMicros;
+	time_t time = holdTime;
+	uint32_t error = holdError;
+	int8_t leap = leapStep;
+	uint32_t source = timeSource();
+	uint32_t elapsed = source - anchor;
+	int32_t sinceLeap = source - leapMicros;	// less than 0 before the leap second
+	interrupts();
+	_us = 0;
+	leapNow = false;
+	if(!time) return 0;
+	if(fixes != holdSeen)
+	{
+		holdSeen = fixes;
+		utcFix(time);
+		holdFix(anchor, time, error);
+	}
+	uint32_t us = (uint64_t)elapsed * 1000000000ULL / (1000000000LL + holdPpb);
+	uint32_t seconds = us / 1000000UL;
+	if(seconds >= 1000)
+	{
+		uint32_t step = (uint64_t)seconds * 1000000ULL * (1000000000LL + holdPpb) / 1000000000ULL;
+		noInterrupts();
+		if(holdFixes == fixes)
+		{
+			holdMicros = anchor + step;
+			holdTime = time + seconds;
+		}
+		interrupts();
+	}
+	_us = us - seconds * 1000000UL;
+	time += seconds;
+	if(!leap) return time;
+	// at the start of a second put in the clock reads the month end, of one left out a second before
+	int64_t off = ((int64_t)time - (int64_t)utcMonthEnd + (leap < 0)) * 1000000LL + _us - sinceLeap;
+	bool monthEnd = utcMonthEnd && off > -1500000LL && off < 1500000LL;
+	if(monthEnd && leap > 0 && sinceLeap < 1000000L)
+	{
+		leapNow = sinceLeap >= 0;				// in the second put in
+		return time;
+	}
+	if(monthEnd && sinceLeap < 0) return time;
+	noInterrupts();
+	if(holdFixes == fixes && leapStep == leap)
+	{
+		if(monthEnd)
+		{
+			holdTime -= leap;
+			utcDut += leap * 1000;				// UT1 goes on as it was
+		}
+		leapStep = 0;							// done, or not at a month end (a lost or extra pulse)
+	}
+	interrupts();
+	return monthEnd ? time - leap : time;
+}
+
+time_t MsfTimeLib::utcNow(uint32_t &_us)
+{
+	time_t time = holdNow(_us);
+	if(leapNow)
+	{
+		_us = 999999UL;							// 23:59:59 until the second put in is over
+		return utcMonthEnd - 1;
+	}
+	return time;
+}
+
+int32_t MsfTimeLib::offsetAt(time_t _utc)
+{
+	return (utcChange && _utc >= utcChange) ? (int32_t)SECS_PER_HOUR - utcOffsetNow : utcOffsetNow;
+}
+
+time_t MsfTimeLib::now(void)
+{
+	uint32_t us;
+	time_t time = utcNow(us);
+	return time ? time + offsetAt(time) : 0;
+}
+
+uint64_t MsfTimeLib::nowMillis(void)
+{
+	uint32_t us;
+	time_t time = utcNow(us);
+	return time ? (uint64_t)(time + offsetAt(time)) * 1000 + us / 1000 : 0;
+}
+
+time_t MsfTimeLib::nowUtc(void)
+{
+	return nowUtcMillis() / 1000;
+}
+
+uint64_t MsfTimeLib::nowUtcMillis(void)
+{
+	uint32_t us;
+	time_t time = utcNow(us);
+	if(!time) return 0;
+	uint64_t ms = (uint64_t)time * 1000 + us / 1000;
+	// a fix can set the clock back by a little, a step of more than 2s is a correction and is taken
+	if(ms < utcLast && utcLast - ms < 2000) return utcLast;
+	utcLast = ms;
+	return ms;
+}
+
+#if MSF_FEATURES & MSF_FEATURE_DUT
+uint64_t MsfTimeLib::nowUt1Millis(void)
+{
+	uint32_t us;
+	time_t time = holdNow(us);					// UT1 does not stop for a leap second
+	return time ? (uint64_t)time * 1000 + us / 1000 + utcDut : 0;
+}
+#endif
+
+int32_t MsfTimeLib::utcOffset(void)
+{
+	uint32_t us;
+	time_t time = utcNow(us);
+	return time ? offsetAt(time) : 0;
+}
+
+time_t MsfTimeLib::offsetChange(void)
+{
+	uint32_t us;
+	return holdNow(us) ? utcChange : 0;
+}
+
+uint32_t MsfTimeLib::nowUncertaintyMicros(void)
+{
+	uint32_t us;
+	time_t time = holdNow(us);
+	if(!time) return 0xFFFFFFFFUL;
+	// twice the error of the fix plus the oscillator error since the fix, a time source that has not
+	// been measured yet is taken to be out by MSF_HOLD_MAX_PPM
+	uint64_t ppb = holdPpbError == 0xFFFFFFFFUL ? MSF_HOLD_MAX_PPM * 1000UL : holdPpbError;
+	uint64_t error = 2 * fixError + ((uint64_t)(time - fixTime) * 1000000ULL + us) * ppb / 1000000000ULL;
+	return error > 0xFFFFFFFEUL ? 0xFFFFFFFEUL : error;
+}
+
+int32_t MsfTimeLib::driftPpb(void)
+{
+	return holdPpb;
+}
+
+uint32_t MsfTimeLib::driftUncertaintyPpb(void)
+{
+	return holdPpbError;
+}
+#endif
+
+uint16_t MsfTimeLib::getChunk(const MsfBits &_bits, uint8_t _offset, uint8_t _numBits)
+{
+	// return the 'chunk' of up to 16 bits starting (MSB) at bit position bitPointer - _offset.
+	// The last bit of the chunk is bit (_offset - _numBits + 1) of the shift register
+	uint8_t shift = _offset - _numBits + 1;
+	uint16_t mask = (1U << _numBits) - 1;
+	if(shift > 63) return 0;				// older than the 64 bits kept (a minute that never started)
+#if defined(__AVR__)
+	if(shift >= 32) return (_bits.hi >> (shift - 32)) & mask;
+	if(shift + _numBits <= 32) return (_bits.lo >> shift) & mask;
+	return ((_bits.lo >> shift) | (_bits.hi << (32 - shift))) & mask;
+#else
+	return (_bits >> shift) & mask;
+#endif
+}
+
+#if MSF_REPAIR_GROUPS
+bool MsfTimeLib::repairFields(uint32_t _end, uint8_t * _rtc)
+{
+// Each parity group with a bad parity has one wrong bit, any of its data bits or its parity bit (then
+// the data are right). Every choice whose fields are in range is a candidate and the time of the minute
+// after the last fix must be among them, the fix must be less than an hour old. Without a fix nothing
+// is mended: a single candidate that makes a real date turns out to be wrong about one time in six in
+// the noise sweep, as a group with two bad bits passes its parity. With all the parity good the fields
+// must be in range and make a real date with the right weekday.
 
-	// seconds from 1970 till 1 jan 00:00:00 of the given year
-	seconds= Year*(SECS_PER_DAY * 365);
-	for (i = 0; i < Year; i++)
+	uint16_t candidates[4][MSF_HOUR_PARITY_BITS + 1];
+	uint8_t count[4];
+	uint8_t bad = 0;
+	for(uint8_t g = 0; g < 4; g++)
+	{
+		uint8_t offset = pgm_read_byte(&repairGroups[g][0]);
+		uint8_t bits = pgm_read_byte(&repairGroups[g][1]);
+		uint16_t data = getChunk(aBits, offset, bits);
+		bool parity = checkParity(offset, bits, pgm_read_byte(&repairGroups[g][2]));
+		if(!parity && (!repairing || ++bad > MSF_REPAIR_GROUPS)) return false;
+		count[g] = 0;
+		if(repairValid(g, data)) candidates[g][count[g]++] = data;
+		for(uint8_t b = 0; !parity && b < bits; b++)
+		{
+			if(repairValid(g, data ^ (1U << b))) candidates[g][count[g]++] = data ^ (1U << b);
+		}
+		if(!count[g]) return false;
+	}
+	_rtc[MSF_SECOND] = 0;
+	if(bad)
 	{
-		if (LEAP_YEAR(i)) seconds +=  SECS_PER_DAY;   // add extra days for leap years
+		if(!fixBuffer.generation || _end - fixBuffer.startMicros >= 3600000000UL) return false;
+		// the minutes since the last fix, this pulse is second 59 of the minute before the one sent
+		uint8_t minutes = (_end - fixBuffer.startMicros + 30000000UL) / 60000000UL;
+		if(!fromTimeT(fixBuffer.time + minutes * 60UL, _rtc)) return false;
+		uint16_t want[4] = {_rtc[MSF_YEAR], (uint16_t)(_rtc[MSF_MONTH] << MSF_DATE_BITS | _rtc[MSF_DATE]), _rtc[MSF_DAY],
+			(uint16_t)(_rtc[MSF_HOUR] << MSF_MINUTE_BITS | _rtc[MSF_MINUTE])};
+		for(uint8_t g = 0; g < 4; g++)
+		{
+			uint8_t i = 0;
+			while(i < count[g] && candidates[g][i] != want[g]) i++;
+			if(i == count[g]) return false;
+		}
+		return true;
 	}
+	uint8_t check[7];
+	_rtc[MSF_YEAR] = candidates[0][0];
+	_rtc[MSF_MONTH] = candidates[1][0] >> MSF_DATE_BITS;
+	_rtc[MSF_DATE] = candidates[1][0] & 0x3F;
+	_rtc[MSF_DAY] = candidates[2][0];
+	_rtc[MSF_HOUR] = candidates[3][0] >> MSF_MINUTE_BITS;
+	_rtc[MSF_MINUTE] = candidates[3][0] & 0x7F;
+	fromTimeT(toTimeT(_rtc), check);
+	return check[MSF_DAY] == _rtc[MSF_DAY] && check[MSF_DATE] == _rtc[MSF_DATE] && check[MSF_MONTH] == _rtc[MSF_MONTH];
+}
+#endif
+
+uint8_t MsfTimeLib::getParity()
+{
+	// calculate the parity bits and return 0 if all's well
+	// all data and parity bits are relative to the last second received (bit 0 of the shift
+	// registers). This allows for leap seconds which are added or removed at second 16 i.e. before
+	// the actual date & time data. There can be 59 or 61 seconds in a leep minute
+	// Year data parity check
+	if(!checkParity(MSF_YEAR_OFFSET, MSF_YEAR_PARITY_BITS, MSF_YEAR_PARITY_BIT_POS)) return 1;
+	// Month data parity check
+	if(!checkParity(MSF_MONTH_OFFSET, MSF_MONTH_PARITY_BITS, MSF_MONTH_PARITY_BIT_POS)) return 2;
+	// Day of week data parity check
+	if(!checkParity(MSF_WEEKDAY_OFFSET, MSF_WEEKDAY_PARITY_BITS, MSF_WEEKDAY_PARITY_BIT_POS)) return 3;
+	// Time data parity check
+	if(!checkParity(MSF_HOUR_OFFSET, MSF_HOUR_PARITY_BITS, MSF_HOUR_PARITY_BIT_POS)) return 4;
+	return 0;
+}
+
+bool MsfTimeLib::checkParity(uint8_t _offset, uint8_t _numBits, uint8_t _parityBitPos)
+{
+	// odd parity: the data bits of the "A" buffer plus the parity bit of the "B" buffer
+	// must contain an odd number of "1"s. Return true if the parity is Good.
+	// Bit n of parityBits is the parity of all the "A" bits up to n seconds ago so the parity of the
+	// bits from _offset down to _offset - _numBits + 1 is the difference of two of its bits
+	return bitsGet(parityBits, _offset + 1) ^ bitsGet(parityBits, _offset - _numBits + 1) ^ bitsGet(bBits, _parityBitPos);
+}
+
+// days from the 1st of January to the 1st of each month in a common year
+static const uint16_t monthStart[12] PROGMEM = {0,31,59,90,120,151,181,212,243,273,304,334};
+
+// MSF only sends two digit years so the years are 2000 to 2099. In that range every fourth year
+// is a leap year (2000 is, 2100 is not) so the days to the start of a year and month are a
+// closed formula and a table lookup, no loops over the years and months
+
+time_t MsfTimeLib::makeTime()
+{
+	return toTimeT(rtcBuffer);
+}
+
+time_t MsfTimeLib::toTimeT(const volatile uint8_t * _rtc)
+{
+	// convert a BCD rtcBuffer (DS1307/DS3231 layout, year 00-99 = 2000-2099) to a time_t
+	uint8_t year = bcdToDec(_rtc[MSF_YEAR]);
+	uint8_t month = bcdToDec(_rtc[MSF_MONTH]);
+	if(month < 1) month = 1;						// keep a bad month inside the table
+	if(month > 12) month = 12;
+	uint16_t days = DAYS_TO_2000 + year * 365U + ((year + 3) >> 2);	// + one day per leap year before this one
+	days += pgm_read_word(&monthStart[month - 1]);
+	if(month > 2 && !(year & 0x03)) days++;			// past February in a leap year
+	days += bcdToDec(_rtc[MSF_DATE]) - 1;
+	return days * SECS_PER_DAY + bcdToDec(_rtc[MSF_HOUR]) * SECS_PER_HOUR +
+		bcdToDec(_rtc[MSF_MINUTE]) * SECS_PER_MIN + bcdToDec(_rtc[MSF_SECOND]);
+}
 
-	// add days for this year, months start from 1
-	for (i = 1; i < Month; i++)
+bool MsfTimeLib::fromTimeT(time_t _time, volatile uint8_t * _rtc)
+{
+	// fill a BCD rtcBuffer from a time_t, returns false outside 2000 to 2099
+	uint32_t days = _time / SECS_PER_DAY;
+	uint32_t secs = _time % SECS_PER_DAY;
+	if(days < DAYS_TO_2000 || days >= DAYS_TO_2000 + 25UL * DAYS_PER_4_YEARS) return false;
+	_rtc[MSF_SECOND] = decToBcd(secs % 60);
+	_rtc[MSF_MINUTE] = decToBcd((secs / 60) % 60);
+	_rtc[MSF_HOUR] = decToBcd(secs / 3600);
+	_rtc[MSF_DAY] = (days + 4) % 7;					// 1/1/1970 was a Thursday, 0 = Sunday as sent by MSF
+	days -= DAYS_TO_2000;
+	// 4 year cycles starting with a leap year
+	uint8_t year = (days / DAYS_PER_4_YEARS) * 4;
+	uint16_t day = days % DAYS_PER_4_YEARS;
+	bool leap = day < 366;
+	if(!leap)
 	{
-		if ( (i == 2) && LEAP_YEAR(Year)) seconds += SECS_PER_DAY * 29;
-		else seconds += SECS_PER_DAY * monthDays[i-1];  //monthDay array starts from 0
+		day -= 366;
+		year += 1 + day / 365;
+		day %= 365;
 	}
-	seconds+= (Date-1) * SECS_PER_DAY;
-	seconds+= Hour * SECS_PER_HOUR;
-	seconds+= Minute * SECS_PER_MIN;
-    return seconds; 
+	uint8_t month = 12;
+	while(day < pgm_read_word(&monthStart[month - 1]) + (leap && month > 2)) month--;
+	day -= pgm_read_word(&monthStart[month - 1]) + (leap && month > 2);
+	_rtc[MSF_DATE] = decToBcd(day + 1);
+	_rtc[MSF_MONTH] = decToBcd(month);
+	_rtc[MSF_YEAR] = decToBcd(year);
+	return true;
+}
+
+uint8_t MsfTimeLib::decToBcd(uint8_t _dec)	// Convert normal decimal numbers to binary coded decimal
+{
+	return ( (_dec/10*16) + (_dec%10) );
 }
 
 uint8_t MsfTimeLib::bcdToDec(uint8_t _bcd)	// Convert binary coded decimal to normal decimal numbers
@@ -344,11 +2504,14 @@ uint8_t MsfTimeLib::bcdToDec(uint8_t _bcd)	// Convert binary coded decimal to no
   return ( (_bcd/16*10) + (_bcd%16) );
 }
 
+#if MSF_FEATURES & MSF_FEATURE_FREEMEM
 uint32_t MsfTimeLib::freeMem(void)
 {
 // report the free DRAM available for sketches
 #ifdef ESP_H
 	return ESP.getFreeSketchSpace();
+#elif MSF_BOARD_ID == 5
+	return 0;								// not meaningful on a host build
 #else
 	char top;
 	extern char *__brkval;
@@ -356,6 +2519,8 @@ uint32_t MsfTimeLib::freeMem(void)
 	return( __brkval ? &top - __brkval : &top - &__bss_end);
 #endif
 }
+#endif
 
-
-MsfTimeLib msf = MsfTimeLib();
\ No newline at end of file
+#if MSF_GLOBAL_INSTANCE
+MsfTimeLib msf = MsfTimeLib();
+#endif
\ No newline at end of file
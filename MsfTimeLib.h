@@ -46,6 +46,11 @@ typedef unsigned long time_t;
 	#define MSF_BOARD_TYPE 			"ESP8266"
 	#define MSF_AVR_TYPE 			"ESP8266"
 	#define MSF_INT_PINS 			17	// ESP8266-12 (available interrupt pins are device specific)
+#elif !defined(ARDUINO)
+	#define MSF_BOARD_ID 5
+	#define MSF_BOARD_TYPE 			"HOST"
+	#define MSF_AVR_TYPE 			"HOST BUILD (extras/host)"
+	#define MSF_INT_PINS 			2
 #else
 	#define MSF_BOARD_ID 0
 	#define MSF_BOARD_TYPE 			"NOT APPLICABLE"
@@ -53,10 +58,42 @@ typedef unsigned long time_t;
 	#define MSF_INT_PINS 			0
 #endif
 
-// configuration constants:
+// the optional parts of the decoder, MSF_FEATURES adds up the ones that are compiled in. Leaving out
+// the ones a sketch does not use saves flash, RAM and time in the interrupt on a small AVR (see
+// extras/size_report.sh). It can also be given to the compiler with -DMSF_FEATURES=... A part with a
+// size below (MSF_VOTE_DEPTH...) is left out when its bit is not set, whatever the size
+#define MSF_FEATURE_LED 	0x01		// the LED pin given to begin()
+#define MSF_FEATURE_PON 	0x02		// the PON pin given to begin(), rxOn(), rxIsOn()
+#define MSF_FEATURE_DUT 	0x04		// DutPos and DutNeg
+#define MSF_FEATURE_BST 	0x08		// Bst and BstSoon
+#define MSF_FEATURE_HOLD 	0x10		// the holdover clock, now() and the rest
+#define MSF_FEATURE_FREEMEM 0x20		// freeMem()
+#define MSF_FEATURE_DEFER 	0x40		// deferDecode(), poll(), EdgeOverflows
+#define MSF_FEATURE_PLL 	0x80		// the second tick, secondEpochMicros() and the rest
+#define MSF_FEATURE_FIX 	0x100		// getFix() and onMinute()
+#define MSF_FEATURE_EVENTS 	0x200		// onSecond() and onDecodeError()
+#define MSF_FEATURE_GLITCH 	0x400		// setGlitchFilter(), GlitchPulses and GlitchGaps
+#define MSF_FEATURE_CLOCK 	0x800		// setTimeSource(), micros() without it
+#define MSF_FEATURE_VOTE 	0x1000		// voteDecode() (MSF_VOTE_DEPTH)
+#define MSF_FEATURE_AUTO 	0x2000		// MSF_PAD_AUTO (MSF_AUTO_BINS)
+#define MSF_FEATURE_SAMPLED 0x4000		// sampleDecode(), feedSample() (MSF_SAMPLED)
+#define MSF_FEATURE_TRACK 	0x8000		// trackDecode(), TrackedMinutes (MSF_TRACK_RUN)
+#define MSF_FEATURE_QUALITY 0x10000		// getQuality() (MSF_QUALITY)
+#define MSF_FEATURE_REPAIR 	0x20000		// repairDecode(), RepairedMinutes (MSF_REPAIR_GROUPS)
+#define MSF_FEATURE_RECORD 	0x40000		// the edge recorder, record() and the rest (MSF_RECORD_SIZE)
+#define MSF_FEATURE_ALL 	0x7FFFF
+#ifndef MSF_FEATURES
+#define MSF_FEATURES 		MSF_FEATURE_ALL
+#endif
+#if (MSF_FEATURES & MSF_FEATURE_HOLD) && !(MSF_FEATURES & MSF_FEATURE_FIX)
+#error MSF_FEATURE_HOLD needs MSF_FEATURE_FIX, the clock takes BST and DUT1 from the last fix
+#endif
+
+// configuration constants (those inside #ifndef can also be given to the compiler with -D):
 #define MSF_PULSE_LOW LOW			// MSF "off" pulse is LOW
 #define MSF_PULSE_HIGH HIGH			// MSF "off" pulse is HIGH
 #define MSF_NO_PIN -1				// NO PIN used
+#define MSF_NO_INTERRUPT 0x7F		// begin() interrupt number: none, the edges are given to feedEdge()
 
 // padding in ms added to incomming pulse
 #define MSF_PAD_0MS 	0
@@ -66,12 +103,170 @@ typedef unsigned long time_t;
 #define MSF_PAD_20MS 	20
 #define MSF_PAD_25MS 	25
 #define MSF_PAD_30MS 	30
+#define MSF_PAD_AUTO 	127		// measure how much the receiver stretches the pulses (see pulseOffset())
+
+// the self calibrating pulse classifier used with MSF_PAD_AUTO keeps a histogram of the carrier OFF
+// pulse lengths: the number of bins (0 = not compiled in), the width of a bin in ms, and the number of
+// pulses in the 100/200/300/500ms clusters needed before it replaces the nominal thresholds
+#ifndef MSF_AUTO_BINS
+#define MSF_AUTO_BINS 		64
+#endif
+#if !(MSF_FEATURES & MSF_FEATURE_AUTO)
+#undef MSF_AUTO_BINS
+#define MSF_AUTO_BINS 		0
+#endif
+#define MSF_AUTO_BIN 		10
+#define MSF_AUTO_MIN_PULSES 32
+#define MSF_AUTO_RANGE 		50			// the largest receiver offset in ms that is searched for
 
 // internal value for decoding
 #define MIN_STREAM_LEN 	58					// minimum number of seconds to receive for
 											// a valid decode
 #define MSF_MARKER 	0b01111110				// the end marker of the minute
 
+// carrier OFF pulses and carrier ON gaps shorter than this (ms) are glitches (see setGlitchFilter())
+#define MSF_GLITCH_MS 	10
+
+// 1 = the library declares a global MsfTimeLib msf, 0 = the sketch declares its own decoders
+// (one per receiver, see MsfDiversity.h)
+#ifndef MSF_GLOBAL_INSTANCE
+#define MSF_GLOBAL_INSTANCE 	1
+#endif
+
+// size of the edge ring used by the deferred decode mode (power of 2, max 128)
+#define MSF_EDGE_RING_SIZE	16
+
+// the edge recorder (see record()): bytes of RAM for the recording (0 = not compiled in, an UNO has
+// none to spare) and the time unit of the recorded edges, 2^MSF_RECORD_SHIFT us. Each edge takes
+// 2 bytes so 1024 bytes keep the last 4 minutes or so
+#ifndef MSF_RECORD_SIZE
+#if MSF_BOARD_ID == 1
+#define MSF_RECORD_SIZE 	0
+#else
+#define MSF_RECORD_SIZE 	1024
+#endif
+#endif
+#if !(MSF_FEATURES & MSF_FEATURE_RECORD)
+#undef MSF_RECORD_SIZE
+#define MSF_RECORD_SIZE 	0
+#endif
+#define MSF_RECORD_SHIFT 	10
+
+// the decoder statistics (see getStats()): 1 = compiled in (0 costs nothing), the number of bins of
+// the carrier OFF pulse length histogram and the width of a bin in ms (the last bin takes the rest)
+#ifndef MSF_STATS
+#define MSF_STATS 			0
+#endif
+#define MSF_STATS_BINS 		16
+#define MSF_STATS_BIN 		50
+
+// the signal quality estimator (see getQuality()): 1 = compiled in, and how fast it follows the
+// signal, each second moves the averages 1/2^MSF_QUALITY_SHIFT of the way (3 = about 8 seconds)
+#ifndef MSF_QUALITY
+#define MSF_QUALITY 		1
+#endif
+#if !(MSF_FEATURES & MSF_FEATURE_QUALITY) || !(MSF_FEATURES & MSF_FEATURE_PLL)
+#undef MSF_QUALITY
+#define MSF_QUALITY 		0			// the jitter and the missing seconds come from the PLL
+#endif
+#define MSF_QUALITY_SHIFT 	3
+
+// the voting decoder (see voteDecode()): the number of minutes that are combined (1 - 8, 0 = not
+// compiled in) and the lowest Confidence (0 - 100) that gives a time
+#ifndef MSF_VOTE_DEPTH
+#define MSF_VOTE_DEPTH 		4
+#endif
+#if !(MSF_FEATURES & MSF_FEATURE_VOTE)
+#undef MSF_VOTE_DEPTH
+#define MSF_VOTE_DEPTH 		0
+#endif
+#define MSF_VOTE_MIN_CONFIDENCE	50
+
+// the voting decoder measures how long the carrier is OFF in a window of each bit, the windows lie
+// between the end of a stretched "0" and the end of a "1" (ms from the start of the second with the
+// padding added to the end of the pulse)
+#define MSF_SOFT_A_WINDOW 	150			// 'A' bit: 150 - 210ms
+#define MSF_SOFT_B_WINDOW 	250			// 'B' bit: 250 - 310ms
+#define MSF_SOFT_WINDOW_LEN 60
+#define MSF_SOFT_EDGE_WINDOW 60			// a carrier OFF edge this close to the next second starts it
+
+// the repair of minutes that fail their parity (see repairDecode()): the most parity groups mended, one
+// bit each (0 = not compiled in, the fields are not checked either), and the Confidence of a mended minute
+#ifndef MSF_REPAIR_GROUPS
+#define MSF_REPAIR_GROUPS 	2
+#endif
+#if !(MSF_FEATURES & MSF_FEATURE_REPAIR) || !(MSF_FEATURES & MSF_FEATURE_FIX)
+#undef MSF_REPAIR_GROUPS
+#define MSF_REPAIR_GROUPS 	0			// mends towards the minute after the last fix
+#endif
+#define MSF_REPAIR_CONFIDENCE 80
+
+// tracking (see trackDecode()): the seconds in a row of the time data ('A' bits 17 - 59) that must
+// match the predicted minute before it gives the time (0 = not compiled in), the seconds of the time
+// data that must match, with none that do not, for a minute to confirm the fix it was tracked from,
+// how far in ms from the predicted time a carrier OFF edge counts as the start of a second, the
+// seconds without a match before tracking stops until the next fix, and the Confidence of a tracked
+// minute
+#ifndef MSF_TRACK_RUN
+#define MSF_TRACK_RUN 		8
+#endif
+#define MSF_TRACK_VERIFY 	30
+#define MSF_TRACK_WINDOW 	60
+#define MSF_TRACK_COAST 	300UL
+#define MSF_TRACK_CONFIDENCE 90
+#if !(MSF_FEATURES & MSF_FEATURE_TRACK) || !(MSF_FEATURES & MSF_FEATURE_FIX) || !(MSF_FEATURES & MSF_FEATURE_PLL)
+#undef MSF_TRACK_RUN
+#define MSF_TRACK_RUN 		0			// tracks from the last fix with the PLL period
+#endif
+#if MSF_TRACK_RUN && !(MSF_FEATURES & MSF_FEATURE_BST)
+#undef MSF_TRACK_RUN
+#define MSF_TRACK_RUN 		0			// needs BstSoon, the hour changes when BST starts or ends
+#endif
+
+// ParityResult of a minute whose parity is good but whose fields can not be (a month 13, the 31st of
+// April, the wrong weekday...), 1 - 4 are the parity groups that failed
+#define MSF_PARITY_IMPOSSIBLE 	5
+
+// the sampled front end (see sampleDecode()): 1 = compiled in, the lowest match (0 - 100) between
+// the samples of a second and the best pulse template for it to count, the seconds without a match
+// before the second timing is searched for again, how close (ms) to the expected time a carrier
+// OFF sample starts the next second and how long (ms) the carrier must then stay OFF
+#ifndef MSF_SAMPLED
+#define MSF_SAMPLED 		1
+#endif
+#if !(MSF_FEATURES & MSF_FEATURE_SAMPLED)
+#undef MSF_SAMPLED
+#define MSF_SAMPLED 		0
+#endif
+#define MSF_SAMPLE_MATCH 	60
+#define MSF_SAMPLE_MISSES 	3
+#define MSF_SAMPLE_WINDOW 	60
+#define MSF_SAMPLE_SPIKE 	30
+
+// the second tick PLL: the highest gear (loop gain 1/2^gear, 1 - 8), the largest error in us
+// of an edge that is used, the seconds without a usable edge before a new edge can start a new lock,
+// the seconds the PLL carries on without edges, and the delay of the receiver output in us which is
+// taken off secondEpochMicros() (measure it for your receiver)
+#define MSF_PLL_GEARS 		7
+#define MSF_PLL_WINDOW 		40000L
+#define MSF_PLL_HOLD 		30
+#define MSF_PLL_COAST 		120
+#define MSF_RX_DELAY_US 	0
+
+// the holdover clock (see now()): the largest oscillator error in ppm that is believed (ceramic
+// resonators are up to 0.5% out), the error in us of a minute start edge when the PLL can not tell
+// and of a minute start worked out from second 59 when the first seconds of the minute were lost,
+// the shortest time in s between two fixes used to measure the oscillator error and how long one
+// measurement goes on before it starts again (temperature changes the error)
+#define MSF_HOLD_MAX_PPM 	10000L
+#define MSF_HOLD_EDGE_US 	20000UL
+#define MSF_HOLD_LATE_US 	300000UL
+#define MSF_HOLD_MIN_SPAN 	300UL
+#define MSF_HOLD_SPAN 		21600UL
+
+// a timestamp source for the edges, must count us in 32 bits and be safe to call in the interrupt
+typedef unsigned long (*MsfTimeSource)(void);
+
 // the bit offsets of the data segments in the "A" & "B" buffers											
 #define MSF_YEAR_OFFSET 	42
 #define MSF_MONTH_OFFSET 	34
@@ -83,6 +278,11 @@ typedef unsigned long time_t;
 #define MSF_BST_BIT_POS 	1
 #define MSF_BSTSOON_BIT_POS 6
 
+// the DUT1 bit positions from the start of the minute in the "B" buffer
+#define MSF_DUTPOS_POS 		1
+#define MSF_DUTNEG_POS 		9
+#define MSF_DUT_BITS 		8
+
 // the number of bits to be gathered for the time/date data output
 #define MSF_YEAR_BITS 		8
 #define MSF_MONTH_BITS 		5
@@ -113,35 +313,385 @@ typedef unsigned long time_t;
 #define MSF_MONTH	5
 #define MSF_YEAR	6
 
+// The 'A' and 'B' bits of the minute are kept in shift registers, the bit received last
+// is bit 0 so the bit received at position bitPointer - n is bit n. All fields are at fixed
+// offsets from the end of the minute and come out with a single shift and mask.
+// A third register keeps the running parity of the 'A' bits as they arrive so the parity
+// checks at the end of the minute are a few single bit tests.
+// AVR has no native 64 bit shifts so two 32 bit words are used there.
+#if defined(__AVR__)
+struct MsfBits
+{
+	uint32_t lo;							// bits 0 - 31
+	uint32_t hi;							// bits 32 - 63
+};
+#else
+typedef uint64_t MsfBits;
+#endif
+
+// one decoded minute as given out by getFix(), all the fields belong to the same minute
+struct MsfFix
+{
+	uint32_t generation;				// counts the minutes given out since begin(), 0 = none yet
+	uint32_t startMicros;				// time source us of the carrier OFF edge that started the minute
+	time_t time;						// TimeTime
+	uint8_t rtc[7];						// rtcBuffer
+	uint16_t dutPos;					// DutPos (0 without MSF_FEATURE_DUT)
+	uint16_t dutNeg;					// DutNeg
+	int8_t leapSecond;					// LeapSecond
+	bool bst;							// Bst (false without MSF_FEATURE_BST)
+	bool bstSoon;						// BstSoon
+	uint8_t parity;						// ParityResult
+	uint8_t confidence;					// Confidence
+};
+
+// the event callbacks (see onMinute()), _time is the time source us of the carrier OFF edge
+typedef void (*MsfMinuteCallback)(const MsfFix &_fix);	// _fix.startMicros is the edge
+typedef void (*MsfSecondCallback)(uint8_t _second, uint32_t _time);
+typedef void (*MsfErrorCallback)(uint8_t _code, uint32_t _time);
+
+#define MSF_SECOND_UNKNOWN 	0xFF		// onSecond() before the start of a minute has been seen
+
+#if MSF_STATS
+// the time taken by a piece of the decoder, in time source us
+struct MsfStatsTime
+{
+	uint16_t min;						// the shortest, 0xFFFF = not run yet
+	uint16_t max;						// the longest
+	uint32_t sum;						// all of them added up, the mean is sum / count
+	uint32_t count;						// the number of times it ran
+};
+
+// the decoder statistics as given out by getStats(), all counted since begin() or clearStats()
+struct MsfStats
+{
+	MsfStatsTime isr;					// msfPulse(), the whole interrupt
+	MsfStatsTime minute;				// the end of minute decode (parity and fields) inside it
+	uint16_t pulses[MSF_STATS_BINS];	// carrier OFF pulses, bin n = n * MSF_STATS_BIN ms long
+	uint16_t shortPulses;				// pulses too short for a bit (after the padding) and thrown away
+	uint16_t pulses400;					// 400ms pulses, which MSF never sends, thrown away
+	uint16_t bitBonly;					// seconds with a double 100ms pulse ('B' bit only)
+	uint16_t parityFails[4];			// minutes that failed the year, month, weekday and time parity
+	uint16_t minutesStarted;			// START pulses seen
+	uint16_t minutesEnded;				// end markers seen, the minutes that were decoded
+	uint16_t minutesDecoded;			// and those with good parity
+};
+#endif
+
+#if MSF_QUALITY
+// the signal quality as given out by getQuality(), averaged over the last seconds
+struct MsfQuality
+{
+	uint8_t score;						// 0 - 100, 100 = a clean signal, 0 = nothing that can be decoded
+	uint8_t pulseError;					// ms the pulse lengths are from 100/200/300/500ms + offset (mean)
+	int8_t offset;						// ms the receiver lengthens the pulses by (negative = shortens)
+	uint16_t jitter;					// us rms of the second edges about the PLL, 0xFFFF = no lock
+	uint8_t missing;					// % of the seconds without a pulse at their start
+	uint8_t glitches;					// spurious and unusable pulses per minute
+};
+#endif
+
+#if MSF_VOTE_DEPTH
+// the soft bits of one minute for the voting decoder, -100 (certainly "0") to +100 (certainly "1"),
+// 0 = nothing received
+struct MsfSoftFrame
+{
+	int8_t a[35];						// the 'A' bits of seconds 17 - 51 (year to minute)
+	int8_t b[6];						// the 'B' bits of seconds 53 - 58 (BST imminent, parity, BST)
+};
+#endif
+
 class MsfTimeLib
 {
+	friend class MsfDiversity;			// reads the soft frames of each receiver
+	friend class MsfDutyCycle;			// needs to know there is a PON pin
+
 	private:
-		uint8_t aBuffer[8];					// buffer for the 'A' bits
-		uint8_t bBuffer[8];					// buffer for the 'B' bits
-		volatile uint32_t pulseStart;		// milliseconds when start of pulse occurred
-		volatile uint32_t pulseEnd;			// milliseconds when pulse ended
+		MsfBits aBits;						// shift register for the 'A' bits
+		MsfBits bBits;						// shift register for the 'B' bits
+		MsfBits parityBits;					// running parity, bit n = parity of the 'A' bits up to n seconds ago
+		volatile uint32_t pulseStart;		// microseconds when start of pulse occurred
+		volatile uint32_t pulseEnd;			// microseconds when pulse ended
 		volatile uint32_t lastPulseStart;	// the previous pulse start value
+		uint32_t markerStart;				// us of the carrier OFF edge of the last second of the minute decoded
 		volatile uint8_t pulseLength;		// length of pulse/100 as an integer
-		volatile bool bitBonly;				// set if a 'B' only pulse detected
 		volatile uint8_t secondBits;		// bits decoded from seconds
 		volatile uint8_t bitPointer;		// pointer for bits within buffer bytes
-		volatile uint8_t bitCounter;		// used to count number of "1"s in chunk routines
+#if MSF_FEATURES & MSF_FEATURE_LED
 		volatile uint8_t ledPin;			// pin to flash on pulses, 0 = off
+#endif
 		volatile uint8_t msfPin;			// pin for MSF Rx signal
 		volatile bool carrierOff;			// True = Rx output is HIGH when carrier is off
-		volatile bool pinState;				// used for interrupt pin sensing
 		volatile int8_t padding;			// time to add/subtract to/from pulse length measurement in ms
-		volatile bool timeIsSet;			// true when time data has been decoded
+#if MSF_FEATURES & MSF_FEATURE_PON
 		volatile uint8_t ponPin;			// pin used to switch the MSF module on/off. LOW = ON
-				
-		// Function to return x bits from buffer
-		uint8_t getChunk(uint8_t * _buffer, uint8_t _start, uint8_t _numBits);
+#endif
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+		bool deferred;						// true = the ISR only captures edges, poll() decodes them
+#endif
+		// the decoder flags share a byte, only the decoder writes them (begin() and rxOn() with the
+		// interrupts off)
+		volatile bool bitBonly : 1;			// set if a 'B' only pulse detected
+		volatile bool pinState : 1;			// used for interrupt pin sensing
+		volatile bool timeIsSet : 1;		// true when time data has been decoded
+		bool bitPushed : 1;					// the last pulse end added a second to the shift registers
+		bool gapMerged : 1;					// this pulse had a gap, its end replaces the bit of the first part
+#if MSF_AUTO_BINS
+		bool autoPad;						// true = the pulses are classified by the measured clusters
+		uint8_t pulseHist[MSF_AUTO_BINS];	// carrier OFF pulse lengths, bin n = n * MSF_AUTO_BIN ms
+		uint8_t histPulses;					// pulses since the thresholds were last worked out
+		uint16_t pulseThreshold[5];			// ms: too short, 100/200, 200/300, 300/500 and too long
+		volatile int8_t rxOffset;			// the measured lengthening of the pulses in ms
+#endif
+#if MSF_FEATURES & MSF_FEATURE_CLOCK
+		MsfTimeSource timeSource;			// the edge timestamps, micros() unless setTimeSource() is used
+#else
+		static unsigned long timeSource(void) { return micros(); }
+#endif
+#if MSF_FEATURES & MSF_FEATURE_FIX
+		MsfMinuteCallback minuteCallback;	// the event callbacks, NULL = none
+#endif
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+		MsfSecondCallback secondCallback;
+		MsfErrorCallback errorCallback;
+		uint32_t secondEdge;				// us of the carrier OFF edge of the last second given to onSecond()
+		uint8_t secondNumber;				// and its number, MSF_SECOND_UNKNOWN = no START pulse yet
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+		// the glitch filter: a short carrier OFF spike is undone at its end, a short carrier ON gap
+		// joins the two parts of the pulse again
+		uint32_t glitchUs;					// the glitch width in us, 0 = no filter
+		uint32_t offStart;					// us of the carrier OFF edge of the last pulse
+		uint32_t spikeStart;				// pulseStart before that edge, put back for a spike
+		uint32_t spikeOff;					// offStart before that edge, put back for a spike
+		uint32_t spikeEnd;					// us of the end of the spike just removed, 0 = none
+		uint32_t gapStart;					// lastPulseStart before the last pulse end, put back for a gap
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_PLL
+		// the PLL that follows the start of the MSF seconds in time source us
+		volatile uint32_t pllEpoch;			// the start of the last second the PLL has seen
+		volatile uint32_t pllPeriod;		// the length of an MSF second * 256
+		volatile uint8_t pllFraction;		// the part of a us after pllEpoch, in 1/256 us
+		uint32_t pllRest;					// the error in 1/256 us too small to have moved pllPeriod yet
+		volatile uint32_t pllVariance;		// the mean square error of the edges in us*us
+		volatile uint8_t pllGear;			// the loop gain is 1/2^pllGear, 0 = not locked
+		uint8_t pllCount;					// edges used in this gear, in gear 0 set when pllEpoch is a candidate
+		uint8_t pllCoast;					// whole seconds from pllEpoch counted so far (max 255)
+		uint32_t pllCoastAt;				// the time source value they are counted up to
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_HOLD
+		// the holdover clock: the anchor is set by every fix and moved on by now(). The oscillator error
+		// is measured between the first fix of a run (base) and the latest
+		volatile uint32_t holdMicros;		// time source us of the anchor, the start of a second
+		volatile time_t holdTime;			// the time at holdMicros, 0 = no fix yet
+		volatile uint32_t holdError;		// the error of the last fix in us
+		volatile uint8_t holdFixes;			// counts the fixes that set the anchor
+		uint8_t holdSeen;					// holdFixes when the last fix was measured
+		uint32_t baseMicros;				// time source us of the base fix
+		time_t baseTime;					// the time of the base fix, 0 = none
+		uint32_t baseError;					// the error of the base fix in us
+		time_t fixTime;						// the time of the last fix
+		uint32_t fixError;					// the error of the last fix in us
+		int32_t holdPpb;					// the time source runs fast by this many parts per 10^9
+		uint32_t holdPpbError;				// uncertainty of holdPpb, 0xFFFFFFFF = not measured
+		volatile uint32_t leapMicros;		// time source us of the leap second found by the decoder
+		volatile int8_t leapStep;			// +1 a second is put in at leapMicros, -1 one is left out, 0 = none
+		bool leapNow;						// holdNow() is in a second put in
+		// the timescale of the last fix, worked out once by utcFix()
+		int32_t utcOffsetNow;				// local time less UTC in s
+		time_t utcChange;					// UTC of the next BST change (BstSoon), 0 = none known
+		time_t utcMonthEnd;					// UTC of the start of the next month, 0 = after 2099
+		int16_t utcDut;						// DUT1 in ms, UT1 less the clock
+		uint64_t utcLast;					// the last nowUtcMillis()
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+		// edge ring filled by the ISR and emptied by poll() in deferred mode
+		volatile uint32_t edgeTime[MSF_EDGE_RING_SIZE];	// time source us of each captured edge
+		volatile uint8_t edgeLevel[MSF_EDGE_RING_SIZE];	// pin level of each captured edge
+		volatile uint8_t ringHead;			// next slot to be written by the ISR
+		volatile uint8_t ringTail;			// next slot to be read by poll()
+#endif
+
+#if MSF_RECORD_SIZE
+		// the edge recorder, written by the ISR: one varint per edge from recordTail to recordHead
+		uint8_t recordRing[MSF_RECORD_SIZE];
+		volatile uint16_t recordHead;		// next byte to be written
+		volatile uint16_t recordTail;		// first byte of the oldest edge kept
+		uint32_t recordTime;				// time source us the next delta is counted from
+		bool recording;						// true = the edges are recorded
+
+		// Function to record one edge (time in us, pin level)
+		void recordEdge(uint32_t _time, bool _level);
+#endif
+
+#if MSF_STATS
+		MsfStats stats;						// written by the decoder, copied by getStats()
+
+		// Function to add _us to one of the times in stats
+		static void statsTime(MsfStatsTime &_time, uint32_t _us);
+#endif
+
+#if MSF_QUALITY
+		// the signal quality averages, each * 2^MSF_QUALITY_SHIFT, written once a second by the decoder
+		uint16_t qualityError;				// |pulse length - nominal - offset| in ms
+		int16_t qualityOffset;				// pulse length - nominal in ms
+		uint16_t qualityMissing;			// % of the seconds without a pulse
+		uint16_t qualityGlitches;			// bad pulses per minute
+		uint32_t qualityEdge;				// us of the carrier OFF edge of the last second
+		uint16_t qualityCount;				// GlitchPulses + GlitchGaps at that second
+		uint8_t qualityBad;					// pulses too short or 400ms long since then
+
+		// Function to add a pulse of pulseLength that started at _start us and is _length us long,
+		// _second = it starts a second
+		void qualityPulse(uint32_t _start, uint32_t _length, bool _second);
+#endif
+
+#if MSF_FEATURES & MSF_FEATURE_FIX
+		// the last minute for getFix(), written by the decoder only while fixSequence is odd
+		MsfFix fixBuffer;
+		volatile uint8_t fixSequence;		// odd while fixBuffer is being written
+#endif
+
+#if MSF_SAMPLED
+		// the sampled front end: the carrier OFF samples in each 100ms of the first 500ms of a second
+		bool sampled;						// true = feedSample() instead of the interrupt
+		bool sampleSync;					// the start of the seconds has been found
+		bool sampleOff;						// the last sample was carrier OFF
+		bool sampleDone;					// this second has been matched
+		bool sampleTrial;					// this second may still turn out to be a spike
+		bool sampleTrialSync;				// sampleSync before it
+		uint32_t sampleTrialStart;			// sampleStart before it
+		uint8_t sampleMisses;				// seconds in a row without a match
+		uint32_t sampleLast;				// time source us of the last sample
+		uint32_t sampleOnStart;				// us of the last carrier ON edge
+		uint32_t samplePulseEnd;			// us from the start of this second to its first carrier ON, 0 = none yet
+		int32_t sampleStretch;				// us the receiver lengthens the pulses by, measured
+		uint32_t sampleStart;				// us of the start of this second
+		uint8_t sampleCount[5];				// samples in each 100ms
+		uint8_t sampleOffCount[5];			// carrier OFF samples in each 100ms
+		uint8_t sampleSoftCount[2];			// samples in the voting decoder 'A' and 'B' windows
+		uint8_t sampleSoftOff[2];			// carrier OFF samples in them
+		uint8_t sampleOffA;					// ms of carrier OFF in the 'A' window of the last second matched
+		uint8_t sampleOffB;					// and in the 'B' window
+
+		// Function to start the next second at _start us
+		void sampleSecond(uint32_t _start);
+		// Function to match the samples of this second with the pulse templates and decode the edges
+		// of the best one
+		void sampleMatch(void);
+#endif
+
+#if MSF_REPAIR_GROUPS
+		bool repairing;						// true = minutes that fail their parity are mended
+#endif
+#if MSF_TRACK_RUN
+		bool tracking;						// true = the minutes after a fix are tracked
+		uint8_t trackA[8];					// the predicted 'A' bits of the minute being tracked, bit n = second n
+		uint8_t trackB[8];					// and its 'B' bits
+		time_t trackTime;					// the time of the minute being tracked (at its START), 0 = not tracking
+		uint32_t trackEdge;					// us of the carrier OFF edge of the last second that matched
+		int16_t trackSecond;				// its second of the minute being tracked, < 0 = a minute before
+		int8_t trackSeen;					// the last second taken, -1 = none yet in this minute
+		bool trackPending;					// that second has not been compared yet (a 'B' only pulse may follow)
+		uint32_t trackPendingEdge;			// us of its carrier OFF edge
+		uint8_t trackBits;					// and its bits, 'A' = bit 0, 'B' = bit 1, MSF_TRACK_START = a START pulse
+		uint8_t trackRun;					// seconds in a row that matched
+		uint8_t trackMatched;				// seconds that matched in this minute
+		uint8_t trackData;					// and those of the time data (17 - 59)
+		uint8_t trackMissed;				// seconds of the time data that did not match
+		bool trackConfirmed;				// MSF_TRACK_RUN seconds in a row of the time data matched
+		bool trackTrusted;					// the fix tracked from has been confirmed
+
+		// Function to start tracking from the fix just published, its minute started at _start us
+		void trackFix(uint32_t _start, bool _late);
+		// Function to predict the bits of the minute being tracked, false (tracking stops) after 2099
+		bool trackPredict(void);
+		// Function to take the pulse with its carrier OFF edge at _time (bits as trackBits), _replace =
+		// the second part of a 'B' only second
+		void trackPulse(uint32_t _time, uint8_t _bits, bool _replace);
+		// Function to compare the pending second with the prediction
+		void trackCompare(void);
+		// Function to check the carrier OFF edge at _time, true if it starts the minute after a confirmed
+		// one, whose time is then in rtcBuffer
+		bool trackEnd(uint32_t _time);
+#endif
+#if MSF_VOTE_DEPTH
+		bool voting;						// true = the voting decoder is used as well
+		MsfSoftFrame softFrames[MSF_VOTE_DEPTH];	// the last minutes, softFrames[softNewest] is being received
+		uint8_t softNewest;					// the frame of the minute being received
+		uint8_t softMinutes;				// the number of complete minutes in softFrames
+		volatile uint8_t softGeneration;	// counts the minute starts and restarts, see MsfDiversity
+		volatile int8_t softSecond;			// second of the minute being received, -1 = no minute start yet
+		volatile uint32_t softSecondStart;	// us of the start of that second
+		uint32_t softOffStart;				// us of the last carrier OFF edge
+		uint8_t softOffA;					// ms of carrier OFF in the 'A' window of this second
+		uint8_t softOffB;					// ms of carrier OFF in the 'B' window of this second
+		bool softAnchored;					// this second was started by a carrier OFF edge
+
+		// Function to measure one edge for the voting decoder (time in us, true = carrier OFF)
+		void softEdge(uint32_t _time, bool _off);
+		// Function to store the soft bits of the second that ended and start the next at _start us
+		void softNextSecond(uint32_t _start, bool _edge);
+		// Function to vote on _count frames, _frame[i] received _age[i] minutes before the newest
+		// (0 - MSF_VOTE_DEPTH - 1), returns the Confidence
+		static uint8_t vote(const MsfSoftFrame * const * _frame, const uint8_t * _age, uint8_t _count,
+			uint8_t * _rtc, bool &_bst, bool &_bstSoon);
+#endif
+
+		// Function to decode one edge (time in us, pin level) now or in poll()
+		void edge(uint32_t _time, bool _level);
+		// Function to decode one edge (time in us, pin level)
+		void processEdge(uint32_t _time, bool _level);
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+		// Function to call onSecond() for the pulse with its carrier OFF edge at _time, _start = a START pulse
+		void callSecond(uint32_t _time, bool _start);
+#endif
+		// Function to copy the minute that starts at _start us to fixBuffer, _late = _start is not an edge
+		void publishFix(uint32_t _start, bool _late);
+#if MSF_AUTO_BINS
+		// Function to return the pulse length code of a pulse of _length us and add it to the histogram
+		uint8_t pulseClassify(uint32_t _length);
+		// Function to find the pulse clusters in the histogram and set the thresholds between them
+		void pulseCalibrate(void);
+#endif
+#if MSF_FEATURES & MSF_FEATURE_HOLD
+		// Function to measure the oscillator with the fix at _anchor us (time _time, error _error us)
+		void holdFix(uint32_t _anchor, time_t _time, uint32_t _error);
+		// Function to return the UTC time, and in _us the true us into that second, 0 = no fix yet
+		time_t holdNow(uint32_t &_us);
+		// Function to note a leap second after the second that started at _start (interrupt)
+		void leapAhead(uint32_t _start, int8_t _step);
+		// Function to work out the timescale of a new fix at UTC _time
+		void utcFix(time_t _time);
+		// Function to return holdNow() held at 23:59:59.999999 in a second put in
+		time_t utcNow(uint32_t &_us);
+		// Function to return local time less UTC at UTC _utc
+		int32_t offsetAt(time_t _utc);
+#endif
+#if MSF_FEATURES & MSF_FEATURE_PLL
+		// Function to return in _start the PLL start of the second nearest _time and in _error its
+		// error in us, false if the PLL is not locked or _time is too far from it
+		bool pllSecond(uint32_t _time, uint32_t &_start, uint32_t &_error);
+		// Function to count the seconds the PLL has coasted up to _time and to drop the lock after MSF_PLL_COAST
+		void pllCoastTo(uint32_t _time);
+		// Function to steer the PLL with the carrier OFF edge at the start of a second
+		void pllEdge(uint32_t _time);
+#endif
+		// Function to return _numBits bits, the first at position bitPointer - _offset
+		uint16_t getChunk(const MsfBits &_bits, uint8_t _offset, uint8_t _numBits);
 		// Function to fetch the parity bits
 		uint8_t getParity();
 		// Function to check the data and parity bits
-		bool checkParity(uint8_t start, uint8_t numBits, uint8_t parityBitNum);
-		// Function to return a single bit from a buffer
-		bool getBit(uint8_t * _buffer, uint8_t _bitPos);
+		bool checkParity(uint8_t _offset, uint8_t _numBits, uint8_t _parityBitPos);
+#if MSF_REPAIR_GROUPS
+		// Function to put the fields of the minute that ended with the pulse at _end us into _rtc (BCD),
+		// mended if the parity failed. Returns false if they are impossible or can not be mended
+		bool repairFields(uint32_t _end, uint8_t * _rtc);
+#endif
 		// make a time_t compatible reading useable by the Time library
 		time_t makeTime();
 				
@@ -155,11 +705,84 @@ class MsfTimeLib
 		int8_t begin(uint8_t _intNum, int8_t _padding, uint8_t _carrierOff, int8_t _ponPin, int8_t _ledPin);
 				
 		// control		
+#if MSF_FEATURES & MSF_FEATURE_PON
 		void rxOn(uint8_t _rxOn);		// turn ON(LOW) or OFF(HIGH) the MSF Receiver Module
 		uint8_t rxIsOn(void);			// return the PON status of the MSF Receiver Module
+#endif
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+		void deferDecode(bool _defer);	// true = decode in poll() instead of the interrupt
+		uint8_t poll(void);				// decode the edges captured since the last call (deferred mode)
+#endif
+		void voteDecode(bool _vote);	// true = combine several minutes when single minutes fail
+		void repairDecode(bool _repair);	// true = mend a minute with a bad bit or two from its structure
+		void trackDecode(bool _track);	// true = check the minutes after a fix against the predicted bits
+		void sampleDecode(bool _sampled);	// true = no interrupt, the pin is given to feedSample()
+#if MSF_SAMPLED
+		void feedSample(uint8_t _level);	// the pin level, every 2 - 10ms from a timer or loop()
+#endif
+		void feedEdge(uint32_t _time, uint8_t _level);	// an edge timed by the sketch, begin(MSF_NO_INTERRUPT)
+#if MSF_RECORD_SIZE
+		// the edge recorder, keeps the last receiver edges in RAM for dumpRecord() (see notes.txt)
+		void record(bool _record);			// true = start a new recording, false = stop it
+		uint16_t recordBytes(void);			// bytes recorded, 2 or so per edge
+		void dumpRecord(Print &_out);		// write the recording to Serial (or any Print) as text
+#endif
+#if MSF_STATS
+		void getStats(MsfStats &_stats);	// copy of the decoder statistics (MSF_STATS 1)
+		void clearStats(void);				// count from 0 again
+#endif
+#if MSF_QUALITY
+		uint8_t getQuality(MsfQuality &_quality);	// the signal quality now, returns _quality.score
+#endif
+#if MSF_FEATURES & MSF_FEATURE_CLOCK
+		void setTimeSource(MsfTimeSource _source);	// timestamp the edges with _source instead of micros()
+#endif
+		// event callbacks, called where the edges are decoded (see notes.txt), NULL = none
+#if MSF_FEATURES & MSF_FEATURE_FIX
+		void onMinute(MsfMinuteCallback _callback);	// a minute has started, with its fix
+#endif
+#if MSF_FEATURES & MSF_FEATURE_EVENTS
+		void onSecond(MsfSecondCallback _callback);	// a second has been received, 0 - 60
+		void onDecodeError(MsfErrorCallback _callback);	// a minute failed its parity, _code = ParityResult
+#endif
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+		void setGlitchFilter(uint8_t _ms);	// the glitch width in ms (default MSF_GLITCH_MS, 0 = off)
+#endif
+		int8_t pulseOffset(void);		// ms the receiver lengthens the pulses by (MSF_PAD_AUTO), else -padding
+#if MSF_FEATURES & MSF_FEATURE_PLL
+		// the second tick
+		uint32_t secondEpochMicros(void);	// time source us at the start of the current MSF second
+		uint32_t nowMicros(void);			// us since the start of the current MSF second
+		uint16_t uncertaintyMicros(void);	// estimated error of the two above in us, 0xFFFF = no lock
+#endif
+#if MSF_FEATURES & MSF_FEATURE_FIX
+		bool getFix(MsfFix &_fix);			// copy of the last minute decoded, false if there is none yet
+#endif
+#if MSF_FEATURES & MSF_FEATURE_HOLD
+		// the holdover clock, runs on from the last fix with the measured oscillator error
+		time_t now(void);					// the local time now, 0 = no fix yet
+		uint64_t nowMillis(void);			// ms since 1970 local time now, 0 = no fix yet
+		uint32_t nowUncertaintyMicros(void);	// estimated error of now()/nowMillis() in us, 0xFFFFFFFF = no fix
+		int32_t driftPpb(void);				// the time source runs fast by this many parts per 10^9
+		uint32_t driftUncertaintyPpb(void);	// uncertainty of driftPpb(), 0xFFFFFFFF = not measured yet
+		// the timescales, UTC holds at 23:59:59 through a leap second put in
+		time_t nowUtc(void);				// UTC now, 0 = no fix yet
+		uint64_t nowUtcMillis(void);		// ms since 1970 UTC now, never goes back, 0 = no fix yet
+#if MSF_FEATURES & MSF_FEATURE_DUT
+		uint64_t nowUt1Millis(void);		// UT1 now (UTC + DUT1) in ms since 1970, 0 = no fix yet
+#endif
+		int32_t utcOffset(void);			// local time less UTC now in s, 3600 in BST
+		time_t offsetChange(void);			// UTC of the next BST change (BstSoon), 0 = none known
+#endif
 		// utilities
-		uint8_t bcdToDec(uint8_t _bcd);		// convert BCD Byte to Decimal
+		static uint8_t bcdToDec(uint8_t _bcd);	// convert BCD Byte to Decimal
+		static uint8_t decToBcd(uint8_t _dec);	// convert Decimal Byte to BCD
+		// convert a BCD rtcBuffer (7 Bytes, years 2000-2099) to a time_t and back
+		static time_t toTimeT(const volatile uint8_t * _rtc);
+		static bool fromTimeT(time_t _time, volatile uint8_t * _rtc);
+#if MSF_FEATURES & MSF_FEATURE_FREEMEM
 		uint32_t freeMem(void);			// returns the amount of free SDRAM memory
+#endif
 				
 		void msfPulse(void);				// the actual Interrupt routine
 
@@ -167,19 +790,42 @@ class MsfTimeLib
 		volatile int8_t TimeAvailable;		// set to 1 when the time has been decoded and the new minute has started
 		volatile uint8_t TimeReceived;		// the final second of the minute has been received and is being processed
 		volatile uint8_t ParityResult;		// the last parity result
+		volatile uint8_t Confidence;		// 0 - 100, how sure the decoder is of the last time
 		// time data
 		volatile uint8_t rtcBuffer[7];		// BCD buffer for RTC clock bytes
 		volatile bool startOfSecond;		// set at start of second pulse, reset at end of second pulse
 		volatile uint8_t RxSecs;			// number of seconds received for decoding
+#if MSF_FEATURES & MSF_FEATURE_BST
 		volatile bool Bst;					// 1 = BST, 0 = GMT
 		volatile bool BstSoon;				// 1 = BST imminent
+#endif
+#if MSF_FEATURES & MSF_FEATURE_DUT
 		volatile uint16_t DutPos;			// DUT1 Positive value in ms
 		volatile uint16_t DutNeg;			// DUT1 Negative value in ms
+#endif
 		volatile time_t TimeTime;			// time_t compatible for use with Time/RTC library
 		volatile int8_t LeapSecond;			// set to either -1 or +1 if a leap second is detected
 		volatile uint8_t NumSeconds;		// the number of seconds received so far
+#if MSF_FEATURES & MSF_FEATURE_DEFER
+		volatile uint8_t EdgeOverflows;		// edges lost because poll() was not called often enough
+#endif
+#if MSF_FEATURES & MSF_FEATURE_GLITCH
+		volatile uint16_t GlitchPulses;		// carrier OFF spikes removed by the glitch filter
+		volatile uint16_t GlitchGaps;		// carrier ON gaps in a pulse removed by the glitch filter
+#endif
+#if MSF_REPAIR_GROUPS
+		volatile uint16_t RepairedMinutes;	// minutes that failed their parity and were mended
+#endif
+#if MSF_TRACK_RUN
+		volatile uint16_t TrackedMinutes;	// minutes given by tracking when the decode failed
+#endif
+#if MSF_RECORD_SIZE
+		volatile uint16_t RecordDropped;	// the oldest recorded edges dropped to make room for new ones
+#endif
 };
 
+#if MSF_GLOBAL_INSTANCE
 extern MsfTimeLib msf;
+#endif
 
 #endif
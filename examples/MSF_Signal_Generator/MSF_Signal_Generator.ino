@@ -0,0 +1,59 @@
+/* MSF SIGNAL GENERATOR FOR THE ARDUINO
+
+ This sketch does the same job as the MSF_Signal_Simulator sketch but uses the
+ MsfSignalGen class from the MsfTimeLib library to build the signal. The output
+ pin can be connected to the interrupt pin of a second Arduino running the
+ MSF_Clock_Test sketch.
+
+ Unlike the simulator, MsfSignalGen can add receiver and radio impairments to
+ the signal (jitter, pulse stretching, missing seconds, spurious pulses and fades)
+ which is useful to see how a receiving sketch copes with a poor signal.
+
+ (C) 2016 by Phil Morris
+ */
+
+#include <MsfTimeLib.h>
+#include <MsfSignalGen.h>
+
+/* USER CONFIGURATION */
+#define PIN_CARRIER 13          // the output pin for the MSF signal
+#define CARRIER_OFF HIGH        // the logic level when the Carrier is OFF
+#define START_TIME 1451997000UL // the first minute sent, time_t (5 Jan 2016 12:30:00)
+#define DUT1 0                  // DUT1 in units of 100ms, -8 to +8
+#define BST 0                   // BST is active "0" or "1"
+#define BST_IMMINENT 0          // BST is about to start "0" or "1"
+
+MsfSignalGen gen;
+uint32_t edgeMs;
+uint8_t edgeLevel;
+
+void setup()
+{
+  Serial.begin(115200);
+  pinMode(PIN_CARRIER, OUTPUT);
+  digitalWrite(PIN_CARRIER, !CARRIER_OFF);  // carrier ON
+  gen.setDut1(DUT1);
+  gen.setBst(BST, BST_IMMINENT);
+  // add some impairments (all zero = a clean signal)
+  MsfNoise noise = {0};
+  noise.jitterMs = 5;           // +/- 5ms of timing jitter
+  noise.stretchMs = 10;         // the receiver stretches pulses by 10ms
+  noise.glitch = 20;            // 2% of seconds have a spurious pulse...
+  noise.glitchMs = 20;          // ...of up to 20ms
+  gen.setNoise(noise);
+  // start the first minute in one second
+  gen.begin(START_TIME, millis() + 1000, CARRIER_OFF);
+  gen.nextEdge(edgeMs, edgeLevel);
+}
+
+void loop()
+{
+  // wait for the edge to be due, then output it and fetch the next one
+  if ((int32_t)(millis() - edgeMs) >= 0)
+  {
+    digitalWrite(PIN_CARRIER, edgeLevel);
+    gen.nextEdge(edgeMs, edgeLevel);
+  }
+}
+
+// END OF MSF SIGNAL GENERATOR SKETCH (C) 2016 by Phil Morris
@@ -0,0 +1,106 @@
+/************************************************************************************
+ Minimal Arduino core replacement used to build MsfTimeLib on a Linux/macOS host
+
+ Only the parts of the core used by the library are provided. The clock and the
+ receiver pins are set by the host program, attachInterrupt() just remembers the
+ handler so hostEdge() can call it exactly like the hardware would. As on an UNO
+ pin 2 is interrupt 0 and pin 3 is interrupt 1:
+
+	hostEdge(1234, HIGH);		// at 1234 ms pin 2 went HIGH, run interrupt 0
+	hostEdge(1234, HIGH, 3);	// the same for pin 3 and interrupt 1
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#define HIGH 	0x1
+#define LOW  	0x0
+#define INPUT 	0x0
+#define OUTPUT 	0x1
+#define CHANGE 	1
+#define DEC 	10
+#define HEX 	16
+
+#define constrain(amt,low,high) ((amt)<(low)?(low):((amt)>(high)?(high):(amt)))
+
+#define bitRead(value, bit) (((value) >> (bit)) & 0x01)
+#define bitSet(value, bit) ((value) |= (1UL << (bit)))
+#define bitClear(value, bit) ((value) &= ~(1UL << (bit)))
+#define bitWrite(value, bit, bitvalue) ((bitvalue) ? bitSet(value, bit) : bitClear(value, bit))
+
+// there is only one address space on a host
+#define PROGMEM
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+
+// the parts of Print used by the library, a host program derives from it to write to a FILE
+class Print
+{
+	public:
+		virtual size_t write(uint8_t _c) = 0;
+		size_t print(const char *_s) { size_t n = 0; while(*_s) n += write(*_s++); return n; }
+		size_t print(unsigned long _n, int _base = DEC)
+		{
+			char buf[33];
+			char *p = buf + sizeof(buf) - 1;
+			*p = 0;
+			do { *--p = "0123456789ABCDEF"[_n % _base]; _n /= _base; } while(_n);
+			return print(p);
+		}
+		size_t println(void) { return print("\r\n"); }
+};
+
+// host state, one instance per thread: a thread that runs decoders of its own (begin(MSF_NO_INTERRUPT)
+// and feedEdge(), see msf_batch.cpp) has its own clock and pins
+struct HostState
+{
+	uint64_t micros;					// the current time in microseconds, never wraps
+	uint8_t pin[256];					// digital pin levels
+	void (*isr[2])(void);				// the handlers given to attachInterrupt() for interrupts 0 and 1
+};
+
+inline HostState &hostState(void)
+{
+	static thread_local HostState state;
+	return state;
+}
+
+// the Arduino functions used by the library
+inline unsigned long millis(void) { return (uint32_t)(hostState().micros / 1000); }
+inline unsigned long micros(void) { return (uint32_t)hostState().micros; }
+inline int digitalRead(uint8_t _pin) { return hostState().pin[_pin]; }
+inline void digitalWrite(uint8_t _pin, uint8_t _val) { hostState().pin[_pin] = _val; }
+inline void pinMode(uint8_t, uint8_t) {}
+inline void attachInterrupt(uint8_t _int, void (*_isr)(void), int) { if(_int < 2) hostState().isr[_int] = _isr; }
+inline void detachInterrupt(uint8_t _int) { if(_int < 2) hostState().isr[_int] = NULL; }
+inline void noInterrupts(void) {}
+inline void interrupts(void) {}
+
+// host control: set the clock
+inline void hostSetMillis(uint32_t _ms) { hostState().micros = _ms * 1000ULL; }
+inline void hostSetMicros(uint64_t _us) { hostState().micros = _us; }
+
+// host control: the receiver pin changed to _level at _us, run the interrupt handler
+inline void hostEdgeMicros(uint64_t _us, uint8_t _level, uint8_t _pin = 2)
+{
+	hostSetMicros(_us);
+	hostState().pin[_pin] = _level;
+	uint8_t interrupt = _pin - 2;
+	if(interrupt < 2 && hostState().isr[interrupt]) hostState().isr[interrupt]();
+}
+
+// host control: the same at _ms
+inline void hostEdge(uint32_t _ms, uint8_t _level, uint8_t _pin = 2)
+{
+	hostEdgeMicros(_ms * 1000ULL, _level, _pin);
+}
+
+#endif
@@ -0,0 +1,460 @@
+/************************************************************************************
+ MsfTimeLib host batch decoder
+
+ Decodes a whole archive of edge traces, or a large number of generated signals, on
+ every core of a Linux/macOS host. Each job (one trace or one generated signal with one
+ decoder setting) has a decoder of its own, started with begin(MSF_NO_INTERRUPT) and
+ fed with feedEdge(), and the host clock is one per thread (see Arduino.h in this
+ folder) so the jobs share nothing. A work stealing pool shares them out: each thread
+ starts with a run of jobs of its own and takes them from the front, a thread that has
+ run out takes the last job of another thread.
+
+ Build from the library folder:
+
+	g++ -O2 -std=gnu++11 -pthread -Iextras/host -I. extras/host/msf_batch.cpp MsfTimeLib.cpp MsfSignalGen.cpp -o msf_batch
+
+ Usage:
+
+	msf_batch [options] <trace files>		decode each trace (msf_replay traces or dumpRecord() recordings)
+	msf_batch -g <minutes> -n <jobs> [options]	decode <jobs> generated signals of <minutes> each
+
+ Options:
+	-J <threads>	threads (default: one per core)
+	-L				scaling: run the batch with 1, 2, 4 ... threads and print the speed up
+	-t <time_t>		start time of the first generated signal, each job starts an hour later
+	-p <list>		the paddings to try, comma separated (ms or a = MSF_PAD_AUTO, default 10)
+	-G <list>		the glitch filter widths to try (setGlitchFilter(), default MSF_GLITCH_MS)
+	-j -s -o -x -X -f -F -r		noise as msf_replay, job n has the seed r + n * 7919
+	-V				use the voting decoder (voteDecode(true))
+	-M				mend minutes that fail their parity (repairDecode(true))
+	-T				track the minutes after a fix (trackDecode(true))
+	-q				quiet, print the summary only
+
+ Every padding is tried with every glitch filter width, each pair is a setting. Output, the
+ minutes of each job in job order (the same whatever the number of threads):
+
+	<job> <setting> FIX <TimeTime> parity=<n> bst=<0|1> conf=<0-100>
+	<job> <setting> WRONG <TimeTime> expected=<time_t>	a generated signal sent another minute
+	<job> <setting> FAIL parity=<n>						end marker seen but parity failed
+	<job> <setting> REPEAT <TimeTime> conf=<0-100>		a minute the job has given already
+
+ then one line per setting, minutes = the minutes generated or the whole minutes a trace spans,
+ fixes = the different minutes given (a repeat is not counted again) and yield = the correct fixes
+ per minute:
+
+	setting <n> padding=<ms> glitch=<ms> jobs=<n> minutes=<n> fixes=<n> wrong=<n> failures=<n> repeats=<n> yield=<%>
+
+ and the run, steals = the jobs taken from another thread:
+
+	batch threads=<n> jobs=<n> edges=<n> seconds=<s> edges/s=<n> steals=<n>
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#include <stdio.h>
+#include <time.h>
+#include <vector>
+#include <set>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <MsfTimeLib.h>
+#include <MsfSignalGen.h>
+#include "msf_trace.h"
+
+#if MSF_FEATURES != MSF_FEATURE_ALL
+#error msf_batch needs all the MSF_FEATURES
+#endif
+
+#define BATCH_FIX 		0
+#define BATCH_WRONG 	1
+#define BATCH_FAIL 		2
+#define BATCH_REPEAT 	3
+
+// one minute of a job
+struct BatchMinute
+{
+	uint8_t kind;						// BATCH_FIX, BATCH_WRONG, BATCH_FAIL or BATCH_REPEAT
+	uint8_t parity;
+	uint8_t bst;
+	uint8_t confidence;
+	time_t time;
+	time_t expected;					// BATCH_WRONG: the minute sent
+};
+
+// a decoder setting of the sweep
+struct BatchSetting
+{
+	int8_t padding;
+	int16_t glitchMs;					// -1 = the library default
+};
+
+// one trace or generated signal decoded with one setting
+struct BatchJob
+{
+	uint32_t input;						// the trace (or generated signal) number
+	uint16_t setting;
+	bool missing;						// the trace could not be read
+	uint32_t edges;
+	uint32_t minutes;
+	uint32_t fixes;
+	uint32_t wrong;
+	uint32_t failures;
+	uint32_t repeats;					// fixes of a minute given before, not in fixes
+	std::vector<BatchMinute> results;
+};
+
+// the jobs not started yet, a queue per thread. A thread takes its own jobs from the front and,
+// when it has none left, the last job of the next thread that has any. The queues are only
+// locked for the moment a job is taken, the jobs run unlocked
+class WorkPool
+{
+	private:
+		struct Queue
+		{
+			std::mutex lock;
+			std::deque<uint32_t> jobs;
+		};
+		std::vector<Queue *> queues;
+
+	public:
+		std::atomic<uint32_t> Steals;
+
+		WorkPool(uint32_t _jobs, uint16_t _threads) : Steals(0)
+		{
+			// each thread starts with a run of jobs next to each other
+			for(uint16_t t = 0; t < _threads; t++)
+			{
+				queues.push_back(new Queue);
+				for(uint32_t j = (uint64_t)_jobs * t / _threads; j < (uint64_t)_jobs * (t + 1) / _threads; j++) queues[t]->jobs.push_back(j);
+			}
+		}
+
+		~WorkPool()
+		{
+			for(size_t t = 0; t < queues.size(); t++) delete queues[t];
+		}
+
+		// the next job for _thread, false when there are none left anywhere
+		bool next(uint16_t _thread, uint32_t &_job)
+		{
+			for(size_t i = 0; i < queues.size(); i++)
+			{
+				Queue &q = *queues[(_thread + i) % queues.size()];
+				std::lock_guard<std::mutex> hold(q.lock);
+				if(q.jobs.empty()) continue;
+				if(i)
+				{
+					_job = q.jobs.back();
+					q.jobs.pop_back();
+					Steals++;
+				}
+				else
+				{
+					_job = q.jobs.front();
+					q.jobs.pop_front();
+				}
+				return true;
+			}
+			return false;
+		}
+};
+
+static std::vector<const char *> traces;
+static std::vector<BatchSetting> settings;
+static std::vector<BatchJob> jobs;
+static uint32_t genMinutes = 0;				// -g, 0 = decode the traces
+static time_t startTime = 1453203000;
+static MsfNoise noise;
+static uint32_t seed = 1;
+static bool voteMode = false;
+static bool repairMode = false;
+static bool trackMode = false;
+
+// the decoder of a job, fed one edge at a time
+struct BatchDecoder
+{
+	MsfTimeLib rx;
+	BatchJob *job;
+	MsfSignalGen *gen;					// NULL = a trace, nothing to check the fixes against
+	uint8_t lastReceived;
+	std::set<time_t> given;				// the minutes given so far, each is counted once
+
+	void edge(uint32_t _ms, uint8_t _level)
+	{
+		uint64_t us = _ms * 1000ULL;
+		hostSetMicros(us);					// this thread's clock
+		rx.feedEdge((uint32_t)us, _level);
+		job->edges++;
+		BatchMinute m;
+		memset(&m, 0, sizeof(m));
+		if(rx.TimeReceived && !lastReceived && rx.ParityResult)
+		{
+			m.kind = BATCH_FAIL;
+			m.parity = rx.ParityResult;
+			job->results.push_back(m);
+			job->failures++;
+		}
+		lastReceived = rx.TimeReceived;
+		if(!rx.TimeAvailable) return;
+		rx.TimeAvailable = 0;
+		MsfFix fix;
+		rx.getFix(fix);
+		m.kind = BATCH_FIX;
+		m.parity = fix.parity;
+		m.bst = fix.bst;
+		m.confidence = fix.confidence;
+		m.time = fix.time;
+		if(!given.insert(fix.time).second)
+		{
+			m.kind = BATCH_REPEAT;
+			job->repeats++;
+			job->results.push_back(m);
+			return;
+		}
+		job->fixes++;
+		// the fix is the time of the minute just started, allow for an edge (a glitch) just before it
+		if(gen && fix.time != gen->minuteTime() && fix.time != gen->minuteTime() + 60)
+		{
+			m.kind = BATCH_WRONG;
+			m.expected = gen->minuteTime();
+			job->wrong++;
+		}
+		job->results.push_back(m);
+	}
+};
+
+static void runJob(BatchJob &_job)
+{
+	const BatchSetting &s = settings[_job.setting];
+	_job.missing = false;
+	_job.edges = _job.minutes = _job.fixes = _job.wrong = _job.failures = _job.repeats = 0;
+	_job.results.clear();
+	std::vector<Edge> edges;
+	if(!genMinutes && (!readTrace(traces[_job.input], edges) || edges.empty()))
+	{
+		_job.missing = true;
+		return;
+	}
+	BatchDecoder d;
+	MsfSignalGen gen;
+	d.job = &_job;
+	d.gen = genMinutes ? &gen : NULL;
+	d.lastReceived = 0;
+	hostSetMicros(0);
+	d.rx.begin(MSF_NO_INTERRUPT, s.padding, MSF_PULSE_HIGH, 0, 0);
+	d.rx.voteDecode(voteMode);
+	d.rx.repairDecode(repairMode);
+	d.rx.trackDecode(trackMode);
+	if(s.glitchMs >= 0) d.rx.setGlitchFilter(s.glitchMs);
+	if(genMinutes)
+	{
+		// as msf_replay -g, run until the start of the minute after the last one so it is delivered
+		time_t start = startTime + (time_t)_job.input * 3600;
+		gen.begin(start, 1000);
+		gen.setNoise(noise);
+		gen.setSeed(seed + _job.input * 7919);
+		uint32_t ms;
+		uint8_t level;
+		do
+		{
+			gen.nextEdge(ms, level);
+			d.edge(ms, level);
+		} while(gen.minuteTime() < start + (time_t)genMinutes * 60);
+		_job.minutes = genMinutes;
+		return;
+	}
+	for(size_t i = 0; i < edges.size(); i++) d.edge(edges[i].ms, edges[i].level);
+	_job.minutes = (edges.back().ms - edges.front().ms) / 60000UL;
+}
+
+static void worker(WorkPool *_pool, uint16_t _thread)
+{
+	uint32_t job;
+	while(_pool->next(_thread, job)) runJob(jobs[job]);
+}
+
+// run all the jobs on _threads threads, returns the seconds taken
+static double runBatch(uint16_t _threads, uint32_t &_steals)
+{
+	WorkPool pool(jobs.size(), _threads);
+	std::vector<std::thread> threads;
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	for(uint16_t t = 0; t < _threads; t++) threads.push_back(std::thread(worker, &pool, t));
+	for(uint16_t t = 0; t < _threads; t++) threads[t].join();
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	_steals = pool.Steals;
+	return (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+}
+
+// a comma separated list of numbers, "a" = _auto
+static std::vector<int16_t> parseList(const char *_list, int16_t _auto)
+{
+	std::vector<int16_t> values;
+	char *p = (char *)_list;
+	while(*p)
+	{
+		if(*p == 'a')
+		{
+			values.push_back(_auto);
+			p++;
+		}
+		else values.push_back(strtol(p, &p, 10));
+		if(*p == ',') p++;
+		else if(*p) break;					// not a number
+	}
+	return values;
+}
+
+// a checksum of the results, the same whatever the number of threads
+static uint64_t resultSum(void)
+{
+	uint64_t sum = 0;
+	for(size_t j = 0; j < jobs.size(); j++)
+	{
+		for(size_t m = 0; m < jobs[j].results.size(); m++)
+		{
+			sum = sum * 1000003ULL + jobs[j].results[m].time * 4 + jobs[j].results[m].kind;
+		}
+	}
+	return sum;
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t numJobs = 0;
+	uint16_t numThreads = std::thread::hardware_concurrency();
+	bool quiet = false, scaling = false, noisy = false;
+	std::vector<int16_t> paddings(1, MSF_PAD_10MS), glitches(1, -1);
+	memset(&noise, 0, sizeof(noise));
+	noise.glitchMs = 20;
+	noise.fadeSeconds = 5;
+
+	for(int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if(!strcmp(arg, "-g") && hasValue) genMinutes = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-n") && hasValue) numJobs = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-J") && hasValue) numThreads = atoi(argv[++i]);
+		else if(!strcmp(arg, "-L")) scaling = true;
+		else if(!strcmp(arg, "-t") && hasValue) startTime = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-p") && hasValue) paddings = parseList(argv[++i], MSF_PAD_AUTO);
+		else if(!strcmp(arg, "-G") && hasValue) glitches = parseList(argv[++i], -1);
+		else if(!strcmp(arg, "-j") && hasValue) { noise.jitterMs = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-s") && hasValue) { noise.stretchMs = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-o") && hasValue) { noise.dropout = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-x") && hasValue) { noise.glitch = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-X") && hasValue) noise.glitchMs = atoi(argv[++i]);
+		else if(!strcmp(arg, "-f") && hasValue) { noise.fade = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-F") && hasValue) noise.fadeSeconds = atoi(argv[++i]);
+		else if(!strcmp(arg, "-r") && hasValue) seed = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-V")) voteMode = true;
+		else if(!strcmp(arg, "-M")) repairMode = true;
+		else if(!strcmp(arg, "-T")) trackMode = true;
+		else if(!strcmp(arg, "-q")) quiet = true;
+		else traces.push_back(arg);
+	}
+	if(genMinutes) traces.clear();
+	else numJobs = traces.size();
+	if(!numJobs || paddings.empty() || glitches.empty())
+	{
+		fprintf(stderr, "usage: msf_batch <trace files> | -g <minutes> -n <jobs> [options], see the source\n");
+		return 1;
+	}
+	if(!numThreads) numThreads = 1;
+
+	for(size_t p = 0; p < paddings.size(); p++)
+	{
+		for(size_t g = 0; g < glitches.size(); g++)
+		{
+			BatchSetting s;
+			s.padding = paddings[p];
+			s.glitchMs = glitches[g];
+			settings.push_back(s);
+		}
+	}
+	// the jobs of one input are next to each other so a thread reads a trace while it is cached
+	for(uint32_t n = 0; n < numJobs; n++)
+	{
+		for(uint16_t s = 0; s < settings.size(); s++)
+		{
+			BatchJob job = BatchJob();
+			job.input = n;
+			job.setting = s;
+			jobs.push_back(job);
+		}
+	}
+
+	uint32_t steals;
+	double seconds = runBatch(numThreads, steals);
+	uint64_t edges = 0;
+	bool missing = false;
+	for(size_t j = 0; j < jobs.size(); j++)
+	{
+		const BatchJob &job = jobs[j];
+		edges += job.edges;
+		if(job.missing)
+		{
+			if(job.setting == 0) fprintf(stderr, "%s: can not be read\n", traces[job.input]);
+			missing = true;
+			continue;
+		}
+		for(size_t m = 0; !quiet && m < job.results.size(); m++)
+		{
+			const BatchMinute &r = job.results[m];
+			printf("%lu %u ", (unsigned long)job.input, job.setting);
+			if(r.kind == BATCH_FAIL) printf("FAIL parity=%u\n", r.parity);
+			else if(r.kind == BATCH_WRONG) printf("WRONG %lu expected=%lu\n", (unsigned long)r.time, (unsigned long)r.expected);
+			else if(r.kind == BATCH_REPEAT) printf("REPEAT %lu conf=%u\n", (unsigned long)r.time, r.confidence);
+			else printf("FIX  %lu parity=%u bst=%u conf=%u\n", (unsigned long)r.time, r.parity, r.bst, r.confidence);
+		}
+	}
+	bool complete = true;
+	for(uint16_t s = 0; s < settings.size(); s++)
+	{
+		uint32_t count = 0, minutes = 0, fixes = 0, wrong = 0, failures = 0, repeats = 0;
+		for(size_t j = 0; j < jobs.size(); j++)
+		{
+			const BatchJob &job = jobs[j];
+			if(job.setting != s || job.missing) continue;
+			count++;
+			minutes += job.minutes;
+			fixes += job.fixes;
+			wrong += job.wrong;
+			failures += job.failures;
+			repeats += job.repeats;
+		}
+		if(fixes != minutes || wrong) complete = false;
+		printf("setting %u padding=", s);
+		if(settings[s].padding == MSF_PAD_AUTO) printf("a");
+		else printf("%d", settings[s].padding);
+		if(settings[s].glitchMs < 0) printf(" glitch=%d", MSF_GLITCH_MS);
+		else printf(" glitch=%d", settings[s].glitchMs);
+		printf(" jobs=%lu minutes=%lu fixes=%lu wrong=%lu failures=%lu repeats=%lu yield=%.1f%%\n", (unsigned long)count,
+			(unsigned long)minutes, (unsigned long)fixes, (unsigned long)wrong, (unsigned long)failures,
+			(unsigned long)repeats, minutes ? 100.0 * (fixes - wrong) / minutes : 0.0);
+	}
+	printf("batch threads=%u jobs=%lu edges=%llu seconds=%.3f edges/s=%.0f steals=%lu\n", numThreads,
+		(unsigned long)jobs.size(), (unsigned long long)edges, seconds, edges / seconds, (unsigned long)steals);
+
+	if(scaling)
+	{
+		// the same jobs again on 1, 2, 4 ... threads, the results must not change
+		uint64_t sum = resultSum();
+		double one = 0;
+		for(uint16_t t = 1; ; t = t * 2 < numThreads ? t * 2 : numThreads)
+		{
+			double s = runBatch(t, steals);
+			if(t == 1) one = s;
+			printf("scale threads=%u seconds=%.3f speedup=%.2f efficiency=%.0f%% steals=%lu%s\n", t, s, one / s,
+				100.0 * one / s / t, (unsigned long)steals, resultSum() == sum ? "" : " RESULTS DIFFER");
+			if(t >= numThreads) break;
+		}
+	}
+	if(missing) return 1;
+	return (genMinutes && !noisy && !complete) ? 2 : 0;
+}
@@ -0,0 +1,172 @@
+/************************************************************************************
+ One interface for two builds of the decoder, used by msf_fuzz.cpp
+
+ The decoder of the library (MsfTimeLib.cpp) and the frozen copy in reference/ (built
+ in namespace msf_ref by msf_reference.cpp) can not be included in the same file, their
+ macros and class names are the same. Each is wrapped in a DiffAdapter in a file of its
+ own and seen through DiffDecoder, whose state() reads everything a sketch can read.
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#ifndef msf_diff_h
+#define msf_diff_h
+
+#include <Arduino.h>
+
+// the values compared after every edge, in the order of diffNames[]
+#define DIFF_VALUES 	48
+
+static const char * const diffNames[DIFF_VALUES] = {
+	"TimeAvailable", "TimeReceived", "ParityResult", "Confidence", "rtcBuffer", "startOfSecond", "RxSecs",
+	"Bst", "BstSoon", "DutPos", "DutNeg", "TimeTime", "LeapSecond", "NumSeconds", "EdgeOverflows",
+	"GlitchPulses", "GlitchGaps", "RepairedMinutes", "TrackedMinutes",
+	"fix.generation", "fix.startMicros", "fix.time", "fix.rtc", "fix.dutPos", "fix.dutNeg", "fix.leapSecond",
+	"fix.bst", "fix.bstSoon", "fix.parity", "fix.confidence",
+	"pulseOffset()", "secondEpochMicros()", "uncertaintyMicros()", "now()", "nowMillis()",
+	"nowUncertaintyMicros()", "driftPpb()", "driftUncertaintyPpb()", "nowUtcMillis()", "nowUt1Millis()",
+	"utcOffset()", "offsetChange()",
+	"quality.score", "quality.pulseError", "quality.offset", "quality.jitter", "quality.missing",
+	"quality.glitches"
+};
+
+// how a decoder is started
+struct DiffSettings
+{
+	int8_t padding;						// begin() padding, MSF_PAD_AUTO included
+	int16_t glitchMs;					// setGlitchFilter(), -1 = the library default
+	uint8_t carrierOff;					// MSF_PULSE_HIGH or MSF_PULSE_LOW
+	bool deferred;						// deferDecode(true), poll() after every edge
+	bool vote;							// voteDecode(true)
+	bool repair;						// repairDecode(true)
+	bool track;							// trackDecode(true)
+	bool sampled;						// sampleDecode(true), sample() instead of edge()
+};
+
+class DiffDecoder
+{
+	public:
+		virtual ~DiffDecoder() {}
+		virtual void begin(const DiffSettings &_settings) = 0;
+		// an edge at _us (the host clock has been set to it), or with sampled a pin sample
+		virtual void edge(uint32_t _us, uint8_t _level) = 0;
+		virtual void sample(uint8_t _level) = 0;
+		// what a sketch can read, the queries (now(), getQuality() ...) use the host clock
+		virtual void state(int64_t * _values) = 0;
+		// the sketch has seen TimeAvailable
+		virtual void clearAvailable(void) = 0;
+};
+
+// the seven BCD bytes of a time in one value
+template<class T> int64_t diffRtc(const T * _rtc)
+{
+	int64_t v = 0;
+	for(uint8_t i = 0; i < 7; i++) v = (v << 8) | _rtc[i];
+	return v;
+}
+
+// Lib is MsfTimeLib, Fix and Quality its MsfFix and MsfQuality, of either build
+template<class Lib, class Fix, class Quality> class DiffAdapter : public DiffDecoder
+{
+	private:
+		Lib rx;
+		uint8_t noInterrupt;				// MSF_NO_INTERRUPT of the build
+		bool deferred;
+
+	public:
+		DiffAdapter(uint8_t _noInterrupt) : noInterrupt(_noInterrupt), deferred(false) {}
+
+		void begin(const DiffSettings &_settings)
+		{
+			rx.begin(noInterrupt, _settings.padding, _settings.carrierOff, 0, 0);
+			deferred = _settings.deferred;
+			rx.deferDecode(deferred);
+			rx.voteDecode(_settings.vote);
+			rx.repairDecode(_settings.repair);
+			rx.trackDecode(_settings.track);
+			if(_settings.glitchMs >= 0) rx.setGlitchFilter(_settings.glitchMs);
+			rx.sampleDecode(_settings.sampled);
+		}
+
+		void edge(uint32_t _us, uint8_t _level)
+		{
+			rx.feedEdge(_us, _level);
+			if(deferred) rx.poll();
+		}
+
+		void sample(uint8_t _level)
+		{
+			rx.feedSample(_level);
+			if(deferred) rx.poll();
+		}
+
+		void state(int64_t * _values)
+		{
+			Fix fix;
+			Quality quality;
+			memset(&fix, 0, sizeof(fix));
+			rx.getFix(fix);
+			rx.getQuality(quality);
+			int64_t *v = _values;
+			*v++ = rx.TimeAvailable;
+			*v++ = rx.TimeReceived;
+			*v++ = rx.ParityResult;
+			*v++ = rx.Confidence;
+			*v++ = diffRtc(rx.rtcBuffer);
+			*v++ = rx.startOfSecond;
+			*v++ = rx.RxSecs;
+			*v++ = rx.Bst;
+			*v++ = rx.BstSoon;
+			*v++ = rx.DutPos;
+			*v++ = rx.DutNeg;
+			*v++ = rx.TimeTime;
+			*v++ = rx.LeapSecond;
+			*v++ = rx.NumSeconds;
+			*v++ = rx.EdgeOverflows;
+			*v++ = rx.GlitchPulses;
+			*v++ = rx.GlitchGaps;
+			*v++ = rx.RepairedMinutes;
+			*v++ = rx.TrackedMinutes;
+			*v++ = fix.generation;
+			*v++ = fix.startMicros;
+			*v++ = fix.time;
+			*v++ = diffRtc(fix.rtc);
+			*v++ = fix.dutPos;
+			*v++ = fix.dutNeg;
+			*v++ = fix.leapSecond;
+			*v++ = fix.bst;
+			*v++ = fix.bstSoon;
+			*v++ = fix.parity;
+			*v++ = fix.confidence;
+			*v++ = rx.pulseOffset();
+			*v++ = rx.secondEpochMicros();
+			*v++ = rx.uncertaintyMicros();
+			*v++ = rx.now();
+			*v++ = (int64_t)rx.nowMillis();
+			*v++ = rx.nowUncertaintyMicros();
+			*v++ = rx.driftPpb();
+			*v++ = rx.driftUncertaintyPpb();
+			*v++ = (int64_t)rx.nowUtcMillis();
+			*v++ = (int64_t)rx.nowUt1Millis();
+			*v++ = rx.utcOffset();
+			*v++ = rx.offsetChange();
+			*v++ = quality.score;
+			*v++ = quality.pulseError;
+			*v++ = quality.offset;
+			*v++ = quality.jitter;
+			*v++ = quality.missing;
+			*v++ = quality.glitches;
+		}
+
+		void clearAvailable(void)
+		{
+			rx.TimeAvailable = 0;
+		}
+};
+
+// the two builds
+DiffDecoder *newLiveDecoder(void);
+DiffDecoder *newReferenceDecoder(void);
+
+#endif
@@ -0,0 +1,363 @@
+/************************************************************************************
+ MsfTimeLib differential fuzzer
+
+ Feeds the same edges to the decoder of the library and to the frozen reference copy in
+ reference/ (see msf_reference.cpp) and compares everything a sketch can read from them
+ after every edge: the fields, getFix(), the second tick, the holdover clock and
+ getQuality(). A change that is only meant to make the decoder faster or smaller must
+ not change any of it. Each case is a random decoder setting (padding, glitch filter,
+ polarity, deferred, voting, repair, tracking, sampled) and a random stream of edges:
+
+	clean		MsfSignalGen minutes, random time (also year and month ends), DUT1,
+				BST flags and leap seconds
+	noisy		the same with random MsfNoise
+	mutated		the same with edges taken out, moved, doubled and turned over, spikes
+				put in, gaps cut out and the clock jumped forward
+	random		edges at random times
+
+ each started at a random point of its first minute with a random time source offset (so
+ the us wrap) and a little timestamp jitter.
+
+ Build from the library folder:
+
+	g++ -O2 -std=gnu++11 -Iextras/host -I. extras/host/msf_fuzz.cpp extras/host/msf_reference.cpp MsfTimeLib.cpp MsfSignalGen.cpp -o msf_fuzz
+
+ Usage:
+
+	msf_fuzz [options]
+
+ Options:
+	-n <cases>		cases to run (default 1000)
+	-r <seed>		random seed (default 1), a case depends only on the seed and its number
+	-c <case>		run only this case (to look at a difference again)
+	-m <minutes>	the most minutes in a case (default 6)
+	-w				write the edges of a case that differs to fuzz_<case>.txt (msf_replay trace,
+					the us offset and jitter are lost so it may not show the difference)
+
+ Output, for each case that differs (the first edge only):
+
+	DIFF case=<n> kind=<kind> edge=<n> us=<us> level=<0|1>
+		padding=<ms> glitch=<ms> carrier=<0|1> deferred=<0|1> vote=<0|1> repair=<0|1> track=<0|1> sampled=<ms>
+		<value> live=<n> reference=<n>
+
+ then:
+
+	fuzz cases=<n> edges=<n> samples=<n> fixes=<n> differ=<n>
+
+ and it returns 1 if any case differed.
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#include <stdio.h>
+#include <vector>
+#include <MsfTimeLib.h>
+#include <MsfSignalGen.h>
+#include "msf_diff.h"
+
+#if MSF_FEATURES != MSF_FEATURE_ALL || !MSF_QUALITY || !MSF_SAMPLED
+#error msf_fuzz needs all the MSF_FEATURES, MSF_QUALITY and MSF_SAMPLED
+#endif
+
+DiffDecoder *newLiveDecoder(void)
+{
+	return new DiffAdapter<MsfTimeLib, MsfFix, MsfQuality>(MSF_NO_INTERRUPT);
+}
+
+#define FUZZ_CLEAN 		0
+#define FUZZ_NOISY 		1
+#define FUZZ_MUTATED 	2
+#define FUZZ_RANDOM 	3
+
+static const char * const kindNames[4] = {"clean", "noisy", "mutated", "random"};
+
+struct FuzzEdge
+{
+	uint64_t us;
+	uint8_t level;
+};
+
+static uint32_t rng;
+
+// random number 0 to _range - 1 (xorshift)
+static uint32_t rnd(uint32_t _range)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 17;
+	rng ^= rng << 5;
+	return _range ? rng % _range : 0;
+}
+
+// time_t of a UTC date and time (days from the civil calendar)
+static time_t utcTime(int16_t _year, uint8_t _month, uint8_t _day, uint8_t _hour, uint8_t _minute)
+{
+	int16_t y = _year - (_month <= 2);
+	int32_t era = y / 400;
+	uint32_t yoe = y - era * 400;
+	uint32_t doy = (153 * (_month + (_month > 2 ? -3 : 9)) + 2) / 5 + _day - 1;
+	uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+	int32_t days = era * 146097 + (int32_t)doe - 719468;
+	return (time_t)days * 86400 + _hour * 3600 + _minute * 60;
+}
+
+// the start of a case: any minute of 2000 - 2099, or just before the end of a year or a month
+static time_t startTime(void)
+{
+	// one rnd() per statement, the order of the arguments of a call is not fixed
+	int16_t year = 2000 + rnd(100);
+	uint8_t kind = rnd(4);
+	uint8_t month = 1 + rnd(12);
+	uint8_t back = 1 + rnd(8);
+	if(kind == 0) return utcTime(year + 1, 1, 1, 0, 0) - 60 * back;
+	if(kind == 1) return utcTime(year, 3, 1, 0, 0) - 60 * back;	// 28 or 29 Feb
+	if(kind == 2) return utcTime(year, month, 1, 0, 0) - 60 * back;
+	uint8_t day = 1 + rnd(28);
+	uint8_t hour = rnd(24);
+	return utcTime(year, month, day, hour, rnd(60));
+}
+
+// the edges of a case of kind _kind
+static void makeEdges(uint8_t _kind, uint8_t _carrierOff, uint32_t _minutes, std::vector<FuzzEdge> &_edges)
+{
+	uint64_t base = rnd(0xFFFFFFFFUL) + 0x100000000ULL;	// the time source wraps somewhere in the case
+	uint16_t jitterUs = rnd(4) ? rnd(500) : 0;
+	FuzzEdge e;
+	if(_kind == FUZZ_RANDOM)
+	{
+		uint8_t level = _carrierOff;
+		e.us = base;
+		for(uint32_t i = 0; i < _minutes * 150; i++)
+		{
+			e.us += 1000ULL * (rnd(3) ? 1 + rnd(600) : 1 + rnd(1500));
+			e.us += rnd(1000);
+			if(rnd(16)) level = !level;		// now and then the same level twice
+			e.level = level;
+			_edges.push_back(e);
+		}
+		return;
+	}
+
+	MsfSignalGen gen;
+	time_t start = startTime();
+	gen.begin(start, 1000, _carrierOff);
+	MsfNoise noise;
+	memset(&noise, 0, sizeof(noise));
+	if(_kind == FUZZ_NOISY || (_kind == FUZZ_MUTATED && rnd(2)))
+	{
+		noise.jitterMs = rnd(30);
+		noise.stretchMs = (int16_t)rnd(100) - 40;
+		noise.dropout = rnd(3) ? 0 : rnd(100);
+		noise.glitch = rnd(2) ? 0 : rnd(200);
+		noise.glitchMs = 1 + rnd(60);
+		noise.fade = rnd(3) ? 0 : rnd(20);
+		noise.fadeSeconds = 1 + rnd(10);
+	}
+	gen.setNoise(noise);
+	gen.setSeed(1 + rnd(0xFFFFFFF0UL));
+	gen.setDut1((int8_t)rnd(17) - 8);
+	bool bst = rnd(2);
+	gen.setBst(bst, rnd(4) == 0);
+	if(!rnd(5)) gen.setLeapSecond(rnd(2) ? 1 : -1);
+	uint32_t powerUp = 1000 + rnd(60000);
+	uint32_t ms;
+	uint8_t level;
+	do
+	{
+		gen.nextEdge(ms, level);
+		if(ms < powerUp) continue;
+		e.us = base + ms * 1000ULL + (jitterUs ? rnd(jitterUs) : 0);
+		e.level = level;
+		_edges.push_back(e);
+	} while(gen.minuteTime() < start + (time_t)_minutes * 60);
+	if(_kind != FUZZ_MUTATED) return;
+
+	for(uint8_t m = 1 + rnd(20); m && _edges.size() > 4; m--)
+	{
+		size_t i = 1 + rnd(_edges.size() - 2);
+		switch(rnd(6))
+		{
+			case 0:							// an edge lost
+				_edges.erase(_edges.begin() + i);
+				break;
+			case 1:							// an edge moved, between its neighbours
+			{
+				uint64_t low = _edges[i - 1].us + 1, high = _edges[i + 1].us - 1;
+				if(high > low) _edges[i].us = low + rnd((uint32_t)(high - low));
+				break;
+			}
+			case 2:							// a spike
+			{
+				uint64_t gap = _edges[i].us - _edges[i - 1].us;
+				if(gap < 4) break;
+				FuzzEdge a, b;
+				a.us = _edges[i - 1].us + 1 + rnd(gap / 2);
+				b.us = a.us + 1 + rnd(gap / 2 - 1);
+				a.level = !_edges[i - 1].level;
+				b.level = _edges[i - 1].level;
+				_edges.insert(_edges.begin() + i, b);
+				_edges.insert(_edges.begin() + i, a);
+				break;
+			}
+			case 3:							// the receiver lost the signal for up to 2 minutes
+			{
+				uint64_t end = _edges[i].us + 1000ULL * (1 + rnd(120000));
+				size_t j = i;
+				while(j < _edges.size() - 1 && _edges[j].us < end) j++;
+				_edges.erase(_edges.begin() + i, _edges.begin() + j);
+				break;
+			}
+			case 4:							// an edge turned over
+				_edges[i].level = !_edges[i].level;
+				break;
+			case 5:							// the clock jumps forward
+			{
+				uint64_t jump = rnd(2) ? 1000ULL * (1 + rnd(5000)) : 1000000ULL * (1 + rnd(100000));
+				for(size_t j = i; j < _edges.size(); j++) _edges[j].us += jump;
+				break;
+			}
+		}
+	}
+}
+
+// compare the two decoders, prints the values that differ the first time in a case
+static bool compare(DiffDecoder *_live, DiffDecoder *_ref, bool _report)
+{
+	int64_t a[DIFF_VALUES], b[DIFF_VALUES];
+	_live->state(a);
+	_ref->state(b);
+	bool same = true;
+	for(uint8_t v = 0; v < DIFF_VALUES; v++)
+	{
+		if(a[v] == b[v]) continue;
+		same = false;
+		if(_report) printf("\t%s live=%lld reference=%lld\n", diffNames[v], (long long)a[v], (long long)b[v]);
+	}
+	return same;
+}
+
+static void writeEdges(uint32_t _case, const std::vector<FuzzEdge> &_edges)
+{
+	char name[32];
+	snprintf(name, sizeof(name), "fuzz_%lu.txt", (unsigned long)_case);
+	FILE *f = fopen(name, "w");
+	if(!f) return;
+	uint64_t first = _edges.empty() ? 0 : _edges[0].us;
+	fprintf(f, "# msf_fuzz case %lu, the first edge at 1000ms\n", (unsigned long)_case);
+	for(size_t i = 0; i < _edges.size(); i++) fprintf(f, "%llu %u\n", (unsigned long long)((_edges[i].us - first) / 1000 + 1000), _edges[i].level);
+	fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t cases = 1000, seed = 1, maxMinutes = 6;
+	int32_t only = -1;
+	bool write = false;
+	for(int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if(!strcmp(arg, "-n") && hasValue) cases = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-r") && hasValue) seed = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-c") && hasValue) only = strtol(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-m") && hasValue) maxMinutes = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-w")) write = true;
+		else
+		{
+			fprintf(stderr, "usage: msf_fuzz [-n cases] [-r seed] [-c case] [-m minutes] [-w], see the source\n");
+			return 1;
+		}
+	}
+	if(maxMinutes < 2) maxMinutes = 2;
+
+	uint64_t edges = 0, samples = 0, fixes = 0;
+	uint32_t differ = 0, run = 0;
+	for(uint32_t c = only < 0 ? 0 : only; c < (only < 0 ? cases : (uint32_t)only + 1); c++)
+	{
+		rng = (seed * 2654435761UL) ^ (c * 0x9E3779B9UL) ^ 0x5A17C0DEUL;
+		if(!rng) rng = 1;
+		for(uint8_t i = 0; i < 4; i++) rnd(0);
+		run++;
+		DiffSettings s;
+		uint8_t paddings[5] = {0, 10, 20, 30, MSF_PAD_AUTO};
+		s.padding = paddings[rnd(5)];
+		s.glitchMs = rnd(3) ? -1 : rnd(40);
+		s.carrierOff = rnd(4) ? MSF_PULSE_HIGH : MSF_PULSE_LOW;
+		s.deferred = rnd(2);
+		s.vote = rnd(2);
+		s.repair = rnd(2);
+		s.track = rnd(2);
+		uint8_t sampleMs = rnd(5) ? 0 : 2 + rnd(9);
+		s.sampled = sampleMs != 0;
+		uint8_t kind = rnd(4);
+		std::vector<FuzzEdge> stream;
+		makeEdges(kind, s.carrierOff, 2 + rnd(maxMinutes - 1), stream);
+		if(stream.empty()) continue;
+
+		// new decoders for each case, which then depends on nothing before it. They start a second
+		// before the first edge
+		DiffDecoder *live = newLiveDecoder();
+		DiffDecoder *ref = newReferenceDecoder();
+		uint64_t now = stream[0].us - 1000000ULL;
+		hostSetMicros(now);
+		live->begin(s);
+		ref->begin(s);
+		uint8_t level = !s.carrierOff;
+		uint64_t nextSample = now + sampleMs * 500ULL;
+		bool same = compare(live, ref, false);
+		size_t i = 0;
+		for(; same && i < stream.size(); i++)
+		{
+			const FuzzEdge &e = stream[i];
+			// a long silence (the clock jumped) is sampled for its last 10s only, the pin does not change
+			if(sampleMs && e.us > nextSample + 10000000ULL) nextSample += (e.us - nextSample - 10000000ULL) / (sampleMs * 1000ULL) * (sampleMs * 1000ULL);
+			for(uint8_t n = 0; sampleMs && same && nextSample < e.us; nextSample += sampleMs * 1000ULL)
+			{
+				hostSetMicros(nextSample);
+				live->sample(level);
+				ref->sample(level);
+				samples++;
+				if(!(++n & 7)) same = compare(live, ref, false);	// the state lasts, every 8th sample is enough
+			}
+			if(!same) break;
+			level = e.level;
+			hostSetMicros(e.us);
+			if(!sampleMs)
+			{
+				live->edge((uint32_t)e.us, e.level);
+				ref->edge((uint32_t)e.us, e.level);
+			}
+			edges++;
+			same = compare(live, ref, false);
+			// now and then the sketch asks a while after the edge
+			if(same && !rnd(8) && i + 1 < stream.size() && stream[i + 1].us > e.us + 1)
+			{
+				hostSetMicros(e.us + 1 + rnd(stream[i + 1].us - e.us - 1));
+				same = compare(live, ref, false);
+			}
+			int64_t state[DIFF_VALUES];
+			live->state(state);
+			if(state[0])
+			{
+				fixes++;
+				live->clearAvailable();
+				ref->clearAvailable();
+			}
+		}
+		if(!same)
+		{
+			differ++;
+			printf("DIFF case=%lu kind=%s edge=%lu us=%llu level=%u\n", (unsigned long)c, kindNames[kind], (unsigned long)i,
+				(unsigned long long)(i < stream.size() ? stream[i].us : 0), i < stream.size() ? stream[i].level : 0);
+			printf("\tpadding=%d glitch=%d carrier=%u deferred=%u vote=%u repair=%u track=%u sampled=%u\n", s.padding,
+				s.glitchMs < 0 ? MSF_GLITCH_MS : s.glitchMs, s.carrierOff, s.deferred, s.vote, s.repair, s.track, sampleMs);
+			compare(live, ref, true);
+			if(write) writeEdges(c, stream);
+		}
+		delete live;
+		delete ref;
+	}
+	printf("fuzz cases=%lu edges=%llu samples=%llu fixes=%llu differ=%lu\n", (unsigned long)run, (unsigned long long)edges,
+		(unsigned long long)samples, (unsigned long long)fixes, (unsigned long)differ);
+	return differ ? 1 : 0;
+}
@@ -0,0 +1,28 @@
+/************************************************************************************
+ The frozen reference decoder for msf_fuzz.cpp
+
+ reference/MsfTimeLib.h and reference/MsfTimeLib.cpp are a copy of the decoder as it was
+ after the last change that was meant to change what it decodes, the copy is not edited.
+ They are built here in namespace msf_ref so they can be linked with the library's own
+ MsfTimeLib.cpp. The copy's #include <MsfTimeLib.h> finds the header guard already defined
+ and adds nothing, so nothing of the library is seen in this file. Such a change is copied
+ here (cp MsfTimeLib.h MsfTimeLib.cpp extras/host/reference/) once it has been checked, in
+ a commit of its own that says why, so the fuzzer looks for differences from that change on.
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#include <Arduino.h>
+#include "msf_diff.h"
+
+namespace msf_ref
+{
+#include "reference/MsfTimeLib.h"
+#include "reference/MsfTimeLib.cpp"
+}
+
+DiffDecoder *newReferenceDecoder(void)
+{
+	return new DiffAdapter<msf_ref::MsfTimeLib, msf_ref::MsfFix, msf_ref::MsfQuality>(MSF_NO_INTERRUPT);
+}
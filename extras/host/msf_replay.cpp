@@ -0,0 +1,944 @@
+/************************************************************************************
+ MsfTimeLib host replay harness
+
+ Feeds MsfTimeLib with edge traces on a Linux/macOS host through the same interrupt
+ path used on a board (see Arduino.h in this folder) and reports every decoded minute.
+
+ Build from the library folder:
+
+	g++ -O2 -std=gnu++11 -Iextras/host -I. extras/host/msf_replay.cpp MsfTimeLib.cpp MsfSignalGen.cpp MsfDiversity.cpp MsfDutyCycle.cpp -o msf_replay
+
+ Usage:
+
+	msf_replay <trace file>			replay a trace or a dumpRecord() recording ("-" = stdin)
+	msf_replay -g <minutes> [options]	generate (MsfSignalGen) and decode a signal
+	msf_replay -S <trials> [options]	noise sweep: decode rate and time to first fix
+	msf_replay -B <minutes> [options]	benchmark: decode time per edge and per minute
+
+ Options:
+	-t <time_t>		start time of the generated signal (default 1453203000, 19 Jan 2016 11:30)
+	-l <-1|0|1>		leap second at the first UTC month end of the run, or in the first minute if there is none
+	-d <+n|-n>		DUT1 in units of 100 ms (default 0), it moves by the leap second after it
+	-Z <0|1>		BST (1) or not (0) at the start, changing at the first 01:00 UTC (-g only)
+	-p <ms|a>		padding passed to begin() (default 10, a = MSF_PAD_AUTO)
+	-j <ms>			noise: edge jitter +/- ms
+	-s <ms>			noise: receiver pulse stretching in ms (negative = shortening)
+	-o <n>			noise: chance per 1000 seconds of a missing second
+	-x <n>			noise: chance per 1000 seconds of a spurious pulse
+	-X <ms>			noise: maximum width of a spurious pulse (default 20)
+	-f <n>			noise: chance per 1000 seconds of a fade
+	-F <s>			noise: length of a fade in seconds (default 5)
+	-r <seed>		noise random seed (default 1)
+	-c <ppm>		the decoder clock runs <ppm> parts per million fast (negative = slow)
+	-u <us>			edge timestamp jitter +/- us (interrupt latency)
+	-G <ms>			glitch filter width (setGlitchFilter(), default MSF_GLITCH_MS, 0 = off)
+	-D				use deferred decoding (deferDecode(true) + poll())
+	-V				use the voting decoder (voteDecode(true))
+	-M				mend minutes that fail their parity (repairDecode(true))
+	-T				track the minutes after a fix (trackDecode(true))
+	-Q				read getQuality() every second and report its mean
+	-R <1|2>		sweep with this many receivers, each with its own noise, combined by MsfDiversity
+	-H <minutes>[:<s>]	holdover: the signal is lost after <minutes> (and <s> seconds) (-g only), now() runs on
+	-L <s>			late: the first <s> seconds of every other minute are lost (-g only), those fixes come late
+	-K <ms>			sampled decoding: the pin is read every <ms> (sampleDecode(true) + feedSample())
+	-P <ms>			duty cycle the receiver (MsfDutyCycle) keeping nowUtc() within <ms> (-g only)
+	-U				check the UTC, UT1 and local time of the decoder every second (-g only)
+	-w				write the generated trace to stdout instead of decoding it
+	-E				record the edges (record(true)) and write dumpRecord() to stdout at the end
+	-C				use the event callbacks (onMinute(), onSecond(), onDecodeError())
+	-b <ns/edge>,<ns/minute>,<ns>	benchmark limits, -B fails (returns 3) if slower (0 = no limit)
+	-q				quiet, print the summary only
+
+ Trace format, one edge per line, '#' starts a comment:
+
+	<time in ms> <pin level 0|1>
+
+ The receiver is assumed to output HIGH when the carrier is off (MSF_PULSE_HIGH). A file that
+ starts with the MSFREC header of dumpRecord() (see notes.txt) is decoded to the same edges, its
+ levels turned over if the receiver was MSF_PULSE_LOW.
+ Output, one line per minute:
+
+	FIX  <TimeTime> parity=<n> leap=<n> dut1=<+/-ms> bst=<0|1> rxsecs=<n> conf=<0-100>
+	FAIL parity=<n>						end marker seen but parity failed
+
+ and with -g a summary of the second tick PLL from 10 minutes on, sampled 700ms into every second
+ (outside = the seconds further out than 6 times uncertaintyMicros(), without noise the exit status
+ is then 4),
+ and with -p a the receiver offset the pulse classifier has measured, and with -H the largest
+ error of nowMillis() while there is a signal and after it is lost, the measured oscillator
+ error and the seconds in which nowMillis() was further out than nowUncertaintyMicros():
+
+	pll seconds=<n> rms=<us> max=<us> uncertainty=<us> nowmax=<us> outside=<n>
+	auto pulse offset=<ms>
+	holdover signal=<ms> lost=<ms> drift=<ppb>+/-<ppb> uncertainty=<us> outside=<n>
+
+ and with -P the holdover line (lost = while the receiver is off) and what the receiver cost:
+
+	duty on=<s> (<%>) wakeups=<n> fixes=<n> failures=<n> on/fix=<s> settle=<s> attempts=<n>
+
+ and when the library is built with MSF_STATS 1 the decoder statistics of msf (getStats(), the
+ times are 0 as the host clock stands still inside the interrupt):
+
+	stats isr=<min>/<mean>/<max>us minute=<min>/<mean>/<max>us short=<n> 400ms=<n> bonly=<n>
+		parity=<year>/<month>/<weekday>/<time> minutes=<started>/<ended>/<decoded>
+	pulses <count of each MSF_STATS_BIN ms bin>
+
+ and with -T the minutes given by tracking when the decode failed:
+
+	track minutes=<n>
+
+ and with -L the fixes whose startMicros is more than 20ms (MSF_HOLD_EDGE_US) from the start of
+ their minute, without noise the exit status is then 5:
+
+	late fixes=<n> start max=<us> misplaced=<n>
+
+ and with -U the largest error of nowUtcMillis(), nowUt1Millis() and nowMillis() against the time
+ sent (from the first fix, allowing for what the minutes before the signal was lost have told the
+ decoder: a leap second once its minute is over, the BST change from the first BstSoon), the
+ seconds with utcOffset() or offsetChange() wrong and those with an error larger than
+ nowUncertaintyMicros(), without noise the exit status is then 6:
+
+	utc seconds=<n> utc=<ms> ut1=<ms> local=<ms> offset=<n> change=<n> outside=<n>
+
+ and with -Q the means of getQuality() read every second (in the sweep under each level):
+
+	quality score=<0-100> pulse=<ms> offset=<ms> jitter=<us> missing=<%> glitches=<n>/min
+
+ and with -C a MINUTE or ERROR line for every onMinute() and onDecodeError() call and a count of
+ them and of the onSecond() calls, those with an unknown second and those whose edge was not
+ <second> s after the START pulse edge (within 50ms):
+
+	MINUTE <time> start=<us>
+	ERROR code=<n> at=<us>
+	callbacks minutes=<n> seconds=<n> unknown=<n> misnumbered=<n> errors=<n>
+
+ The sweep (-S) runs <trials> power-ups at a random point of the minute for each of
+ the noise levels below, each trial lasting -g minutes (default 30), scaled by the
+ noise options given (default: the built in table) and prints the minute decode
+ rate and the time to first correct fix. With -R 2 a second receiver on interrupt 1
+ hears the same signal with noise of its own and the rate is that of MsfDiversity.
+
+ The benchmark (-B) generates <minutes> of signal into memory first and then times
+ only the decoder, replaying the minutes until at least 1 second has passed. With -b it
+ compares the ns per edge, the ns per minute and the slowest minute end edge (the longest
+ interrupt) with the limits given:
+
+	limits ns/edge=<ns> ns/minute=<ns> minute end max ns=<ns> <ok|SLOWER>
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#include <stdio.h>
+#include <math.h>
+#include <time.h>
+#include <vector>
+#include <algorithm>
+#include <MsfTimeLib.h>
+#include <MsfSignalGen.h>
+#include <MsfDiversity.h>
+#include <MsfDutyCycle.h>
+#include "msf_trace.h"
+
+#if MSF_FEATURES != MSF_FEATURE_ALL
+#error msf_replay needs all the MSF_FEATURES
+#endif
+
+// the noise levels of the sweep, each row is applied on its own
+static const MsfNoise sweepLevels[] =
+{
+	// jitter stretch dropout glitch glitchMs fade fadeSeconds
+	{  0,  0,   0,   0,  0,  0, 0 },
+	{  5, 10,   0,   0,  0,  0, 0 },
+	{ 10, 20,  10,  20, 20,  0, 0 },
+	{ 15, 25,  20,  50, 30,  2, 5 },
+	{ 20, 30,  40, 100, 40,  4, 5 },
+	{ 25, 35,  60, 200, 50,  6, 8 },
+	{ 30, 40, 100, 300, 60, 10, 8 },
+};
+
+static bool quiet = false;
+static bool deferredMode = false;
+static bool voteMode = false;
+static bool repairMode = false;				// -M
+static bool trackMode = false;				// -T
+static bool qualityMode = false;			// -Q
+static int16_t glitchMs = -1;				// -G, -1 = the library default
+static bool writeTrace = false;
+static bool dumpEdges = false;				// -E
+static MsfSignalGen gen;
+static uint8_t receivers = 1;				// -R, 2 = a second receiver (rx2, gen2) and the combiner
+static MsfTimeLib rx2;
+static MsfSignalGen gen2;
+static MsfDiversity diversity;
+static bool generating = false;
+static uint32_t fixes = 0;
+static uint32_t failures = 0;
+static uint32_t wrong = 0;
+static uint8_t lateSeconds = 0;				// -L, the seconds lost at the start of every other minute
+static uint32_t lateFixes = 0;				// fixes checked with -L
+static uint32_t lateMisplaced = 0;			// of them with startMicros off
+static double lateMaxError = 0;				// the largest startMicros error in us
+static uint32_t numEdges = 0;
+static int32_t clockPpm = 0;
+static uint16_t jitterUs = 0;
+static uint32_t usSeed = 1;
+static uint8_t sampleMs = 0;				// -K, 0 = the interrupt decodes the edges
+static uint32_t nextSampleMs = 0;			// generator ms of the next pin sample
+
+// the decoder clock in us at _ms of generator time: clock error and timestamp jitter
+static uint64_t localMicros(uint32_t _ms, bool _jitter)
+{
+	int64_t us = _ms * 1000LL;
+	us += us * clockPpm / 1000000;
+	if(_jitter && jitterUs)
+	{
+		usSeed ^= usSeed << 13;
+		usSeed ^= usSeed >> 17;
+		usSeed ^= usSeed << 5;
+		us += (int32_t)(usSeed % (2 * jitterUs + 1)) - jitterUs;
+	}
+	return us;
+}
+
+// the second tick PLL against the generator seconds
+struct PllStats
+{
+	uint32_t samples;
+	double sumSquares;
+	double maxError;
+	double sumUncertainty;
+	double maxNowError;
+	uint32_t outside;						// seconds with the error more than PLL_SIGMAS * uncertaintyMicros()
+};
+static PllStats pll;
+#define PLL_SIGMAS		6					// uncertaintyMicros() is one standard deviation
+
+// the holdover clock against the generator time
+struct HoldStats
+{
+	double maxSignal;						// the largest nowMillis() error in ms while there is a signal
+	double maxLost;							// and after the signal is lost
+	uint32_t outside;						// seconds with the error larger than nowUncertaintyMicros()
+	uint32_t uncertainty;					// nowUncertaintyMicros() at the last sample
+};
+static HoldStats hold;
+static uint32_t holdAfter = 0;				// -H, minutes before the signal is lost, 0 = never
+static uint8_t holdSeconds = 0;				// -H, and seconds
+static uint32_t lossMs = 0;					// generator ms the signal was lost at, 0 = not yet
+static time_t holdStart = 0;				// the time at generator ms 1000
+static MsfDutyCycle duty;
+static uint32_t dutyBudget = 0;				// -P, the nowUtc() budget in ms, 0 = the receiver is always on
+
+// the UTC, UT1 and local time of the decoder against the time sent (-U)
+struct UtcStats
+{
+	uint32_t seconds;						// seconds checked, from the first fix on
+	double maxUtc, maxUt1, maxLocal;		// the largest nowUtcMillis(), nowUt1Millis() and nowMillis() errors in ms
+	uint32_t offset;						// seconds with utcOffset() wrong
+	uint32_t change;						// seconds with offsetChange() wrong
+	uint32_t outside;						// seconds with an error larger than nowUncertaintyMicros()
+};
+static UtcStats utc;
+static bool utcMode = false;				// -U
+static time_t utcStart = 0;					// UTC at generator ms 1000
+static int8_t utcDut = 0;					// -d, DUT1 sent at the start
+static int8_t bstStart = -1;				// -Z, BST at the start, -1 = no BST change
+static time_t bstChange = 0;				// UTC of the BST change, 0 = none
+static int8_t leapSecond = 0;				// -l
+static time_t leapEnd = 0;					// UTC of the month end of the leap second, 0 = not at one
+
+// the callbacks (-C)
+struct CallbackStats
+{
+	uint32_t minutes, seconds, unknown, misnumbered, errors;
+	uint32_t minuteStart;					// us of the last second 0 edge
+	bool started;							// there has been a second 0
+};
+static bool callbacks = false;
+static CallbackStats calls;
+
+static void minuteEvent(const MsfFix &_fix)
+{
+	calls.minutes++;
+	if(!quiet) printf("MINUTE %lu start=%lu\n", (unsigned long)_fix.time, (unsigned long)_fix.startMicros);
+}
+
+static void secondEvent(uint8_t _second, uint32_t _time)
+{
+	calls.seconds++;
+	if(_second == MSF_SECOND_UNKNOWN)
+	{
+		calls.unknown++;
+		return;
+	}
+	if(_second == 0)
+	{
+		calls.minuteStart = _time;
+		calls.started = true;
+	}
+	int32_t error = (int32_t)(_time - calls.minuteStart - _second * 1000000UL);
+	if(!calls.started || labs(error) > 50000L) calls.misnumbered++;
+}
+
+static void errorEvent(uint8_t _code, uint32_t _time)
+{
+	calls.errors++;
+	if(!quiet) printf("ERROR code=%u at=%lu\n", _code, (unsigned long)_time);
+}
+#define DUTY_PON_PIN	4					// the PON pin given to begin() with -P
+#define DUTY_SETTLE_MS	3000				// the receiver has no output for this long after power on
+
+// sample the PLL at 700ms of the second starting at _ms
+static void samplePll(uint32_t _ms)
+{
+	hostSetMicros(localMicros(_ms + 700, false));
+	uint16_t uncertainty = msf.uncertaintyMicros();
+	if(uncertainty == 0xFFFF) return;
+	int32_t error = msf.secondEpochMicros() - (uint32_t)localMicros(_ms, false);
+	double nowError = fabs((double)msf.nowMicros() - 700000.0);
+	pll.samples++;
+	pll.sumSquares += (double)error * error;
+	if(fabs(error) > pll.maxError) pll.maxError = fabs(error);
+	if(nowError > pll.maxNowError) pll.maxNowError = nowError;
+	pll.sumUncertainty += uncertainty;
+	if(labs(error) > PLL_SIGMAS * (int32_t)uncertainty) pll.outside++;
+}
+
+// the signal quality read once a second (-Q)
+struct QualityStats
+{
+	uint32_t samples;
+	double score, pulseError, offset, jitter, missing, glitches;
+	uint32_t locked;						// samples with a jitter, the PLL was locked
+};
+static QualityStats quality;
+
+// read getQuality() at _ms of generator time
+static void sampleQuality(uint32_t _ms)
+{
+	hostSetMicros(localMicros(_ms, false));
+	MsfQuality q;
+	msf.getQuality(q);
+	quality.samples++;
+	quality.score += q.score;
+	quality.pulseError += q.pulseError;
+	quality.offset += q.offset;
+	quality.missing += q.missing;
+	quality.glitches += q.glitches;
+	if(q.jitter == 0xFFFF) return;
+	quality.jitter += q.jitter;
+	quality.locked++;
+}
+
+// the means of the quality samples, as a line of their own (-g) or sweep columns
+static void printQuality(const char *_prefix)
+{
+	double n = quality.samples ? quality.samples : 1;
+	printf("%sscore=%.0f pulse=%.1fms offset=%+.0fms jitter=%.0fus missing=%.0f%% glitches=%.1f/min\n", _prefix,
+		quality.score / n, quality.pulseError / n, quality.offset / n, quality.locked ? quality.jitter / quality.locked : 0.0,
+		quality.missing / n, quality.glitches / n);
+	memset(&quality, 0, sizeof(quality));
+}
+
+// UTC in ms at generator ms _ms as the decoder should give it: a leap second is found in the second
+// before it (the signal must last into that), it holds 23:59:59.999 through a second put in
+static int64_t utcAt(uint32_t _ms)
+{
+	int64_t elapsed = (int64_t)_ms - 1000;
+	int64_t utc = (int64_t)utcStart * 1000 + elapsed;
+	int64_t at = ((int64_t)leapEnd - utcStart) * 1000 - (leapSecond < 0 ? 1000 : 0);	// the leap second starts
+	if(!leapEnd || elapsed < at || (lossMs && (int64_t)lossMs - 1000 < at - 750)) return utc;
+	if(leapSecond < 0) return utc + 1000;
+	return elapsed < at + 1000 ? (int64_t)leapEnd * 1000 - 1 : utc - 1000;
+}
+
+// the time the decoder should give 700ms into the second starting at _ms: UTC and UT1 in ms, the
+// offset of local time and the BST change it knows of, from the first BstSoon fix before the
+// signal is lost (-H) on. UT1 goes on through a leap second.
+static void trueTime(uint32_t _ms, int64_t &_utc, int64_t &_ut1, int32_t &_offset, time_t &_change)
+{
+	_utc = utcAt(_ms + 700);
+	_ut1 = (int64_t)utcStart * 1000 + _ms + 700 - 1000 + utcDut * 100;
+	// the last fix is that of the minute now, or of the one the signal was lost in
+	time_t seconds = _utc / 1000;
+	time_t last = seconds - seconds % 60;
+	time_t lost = lossMs ? utcAt(lossMs) / 1000 : 0;
+	if(lossMs && last > lost - lost % 60) last = lost - lost % 60;
+	bool told = bstChange && last >= bstChange - 61 * 60;
+	_offset = bstStart > 0 ? 3600 : 0;
+	if(told && seconds >= bstChange) _offset = 3600 - _offset;
+	_change = told && last < bstChange ? bstChange : 0;
+}
+
+// sample the UTC, UT1 and local time at 700ms of the second starting at _ms (-U)
+static void sampleUtc(uint32_t _ms)
+{
+	hostSetMicros(localMicros(_ms + 700, false));
+	uint64_t utcMs = msf.nowUtcMillis();
+	if(!utcMs) return;
+	int64_t trueUtc, trueUt1;
+	int32_t offset;
+	time_t change;
+	trueTime(_ms, trueUtc, trueUt1, offset, change);
+	double utcError = fabs((double)((int64_t)utcMs - trueUtc));
+	double localError = fabs((double)((int64_t)msf.nowMillis() - trueUtc - offset * 1000LL));
+	double ut1Error = fabs((double)((int64_t)msf.nowUt1Millis() - trueUt1));
+	double error = utcError > localError ? utcError : localError;
+	error = ut1Error > error ? ut1Error : error;
+	utc.seconds++;
+	utc.maxUtc = utcError > utc.maxUtc ? utcError : utc.maxUtc;
+	utc.maxUt1 = ut1Error > utc.maxUt1 ? ut1Error : utc.maxUt1;
+	utc.maxLocal = localError > utc.maxLocal ? localError : utc.maxLocal;
+	if(msf.utcOffset() != offset) utc.offset++;
+	if(msf.offsetChange() != change) utc.change++;
+	if(error * 1000.0 > msf.nowUncertaintyMicros() + 1000.0) utc.outside++;	// the ms are truncated
+}
+
+// sample the holdover clock at 700ms of the second starting at _ms
+static void sampleHold(uint32_t _ms, bool _lost)
+{
+	hostSetMicros(localMicros(_ms + 700, false));
+	uint64_t nowMs = msf.nowMillis();
+	if(!nowMs) return;
+	int64_t trueUtc, trueUt1;
+	int32_t offset;
+	time_t change;
+	trueTime(_ms, trueUtc, trueUt1, offset, change);
+	double error = fabs((double)((int64_t)nowMs - trueUtc - offset * 1000LL));
+	uint32_t uncertainty = msf.nowUncertaintyMicros();
+	if(_lost) hold.maxLost = error > hold.maxLost ? error : hold.maxLost;
+	else hold.maxSignal = error > hold.maxSignal ? error : hold.maxSignal;
+	if(error * 1000.0 > uncertainty + 1000.0) hold.outside++;	// nowMillis() truncates to the ms
+	hold.uncertainty = uncertainty;
+}
+
+// -L loses the first seconds of the odd minutes, the even ones keep their START pulse
+static bool lateMinute(void)
+{
+	return (gen.minuteTime() / 60) & 1;
+}
+
+// check the decoder after an edge, returns 1 for a correct fix, -1 for a wrong one
+static int8_t report(void)
+{
+	static uint8_t lastReceived = 0;
+	if(msf.TimeReceived && !lastReceived && msf.ParityResult)
+	{
+		failures++;
+		if(!quiet) printf("FAIL parity=%u\n", msf.ParityResult);
+	}
+	lastReceived = msf.TimeReceived;
+	if(!msf.TimeAvailable) return 0;
+	// the minute is read through getFix(), each fix is the next generation (1 after begin())
+	static uint32_t generation = 0;
+	MsfFix fix;
+	if(!msf.getFix(fix) || (fix.generation != generation + 1 && fix.generation != 1) || fix.time != msf.TimeTime)
+	{
+		printf("FIX  getFix() out of step\n");
+	}
+	generation = fix.generation;
+	int16_t dut = (int16_t)fix.dutPos - (int16_t)fix.dutNeg;
+	if(!quiet) printf("FIX  %lu parity=%u leap=%d dut1=%+d bst=%u rxsecs=%u conf=%u\n", (unsigned long)fix.time,
+		fix.parity, fix.leapSecond, dut, fix.bst, msf.RxSecs, fix.confidence);
+	msf.TimeAvailable = 0;
+	fixes++;
+	// the fix is the time of the minute the generator has just started, allow for an edge
+	// (a glitch) arriving just before the minute start
+	if(generating && fix.time != gen.minuteTime() && fix.time != gen.minuteTime() + 60)
+	{
+		wrong++;
+		return -1;
+	}
+	if(lateSeconds && fix.time == gen.minuteTime() && lateMinute())
+	{
+		// the fix is given at the first edge after the lost seconds, its start is that of the minute
+		double error = fabs((double)(int32_t)(fix.startMicros - (uint32_t)localMicros(gen.minuteStartMs(), false)));
+		lateFixes++;
+		if(error > MSF_HOLD_EDGE_US) lateMisplaced++;
+		if(error > lateMaxError) lateMaxError = error;
+	}
+	return 1;
+}
+
+// decode (or print) one edge
+// with -K the pin is read every sampleMs ms up to _ms (there is no interrupt), returns report() of a fix
+static int8_t sampleTo(uint32_t _ms)
+{
+	int8_t result = 0;
+	for(; nextSampleMs < _ms; nextSampleMs += sampleMs)
+	{
+		hostSetMicros(localMicros(nextSampleMs, true));
+		msf.feedSample(digitalRead(2));
+		if(deferredMode) msf.poll();
+		int8_t fix = report();
+		if(fix) result = fix;
+	}
+	return result;
+}
+
+static int8_t play(uint32_t _ms, uint8_t _level)
+{
+	numEdges++;
+	if(writeTrace)
+	{
+		printf("%lu %u\n", (unsigned long)_ms, _level);
+		return 0;
+	}
+	if(sampleMs)
+	{
+		int8_t fix = sampleTo(_ms);
+		hostState().pin[2] = _level;
+		return fix;
+	}
+	if(clockPpm || jitterUs) hostEdgeMicros(localMicros(_ms, true), _level);
+	else hostEdge(_ms, _level);
+	if(deferredMode) msf.poll();
+	return report();
+}
+
+// dumpRecord() writes to stdout
+class StdoutPrint : public Print
+{
+	public:
+		size_t write(uint8_t _c) { return putchar(_c) == EOF ? 0 : 1; }
+};
+
+static bool startDecoder(int8_t _padding)
+{
+	if(!msf.begin(0, _padding, MSF_PULSE_HIGH, dutyBudget ? DUTY_PON_PIN : 0, 0)) return false;
+	msf.deferDecode(deferredMode);
+	msf.voteDecode(voteMode);
+	msf.repairDecode(repairMode);
+	msf.trackDecode(trackMode);
+	if(glitchMs >= 0) msf.setGlitchFilter(glitchMs);
+	msf.sampleDecode(sampleMs != 0);
+	nextSampleMs = sampleMs / 2;			// the timer ticks half a sample out of step with the seconds
+	if(receivers < 2) return true;
+	if(!rx2.begin(1, _padding, MSF_PULSE_HIGH, 0, 0)) return false;
+	rx2.deferDecode(deferredMode);
+	rx2.voteDecode(true);
+	rx2.repairDecode(repairMode);
+	rx2.trackDecode(trackMode);
+	if(glitchMs >= 0) rx2.setGlitchFilter(glitchMs);
+	msf.voteDecode(true);
+	diversity = MsfDiversity();
+	diversity.add(msf);
+	diversity.add(rx2);
+	return true;
+}
+
+// the next edge of two receivers (-R 2): the earlier of the edges of gen (pin 2) and gen2 (pin 3)
+static void nextEdge2(uint32_t &_ms, uint8_t &_level, uint8_t &_pin, bool _restart)
+{
+	static uint32_t ms[2];
+	static uint8_t level[2];
+	if(_restart)
+	{
+		gen.nextEdge(ms[0], level[0]);
+		gen2.nextEdge(ms[1], level[1]);
+		return;
+	}
+	uint8_t g = (int32_t)(ms[1] - ms[0]) < 0;
+	_ms = ms[g];
+	_level = level[g];
+	_pin = 2 + g;
+	if(g) gen2.nextEdge(ms[1], level[1]);
+	else gen.nextEdge(ms[0], level[0]);
+}
+
+// check the combiner after an edge, returns 1 for a correct fix, -1 for a wrong one
+static int8_t reportDiversity(void)
+{
+	diversity.update();
+	if(!diversity.TimeAvailable) return 0;
+	diversity.TimeAvailable = 0;
+	fixes++;
+	if(diversity.TimeTime != gen.minuteTime() && diversity.TimeTime != gen.minuteTime() + 60)
+	{
+		wrong++;
+		return -1;
+	}
+	return 1;
+}
+
+// noise sweep: decode rate and time to first fix for each noise level
+static void sweep(uint32_t _trials, uint32_t _minutes, time_t _start, int8_t _padding, const MsfNoise *_noise, uint32_t _seed)
+{
+	uint8_t levels = _noise ? 1 : sizeof(sweepLevels) / sizeof(sweepLevels[0]);
+	uint32_t rng = _seed;
+	quiet = true;
+	generating = true;						// a wrong fix is counted as wrong, not as decoded
+	printf("level jitter stretch dropout glitch fade  decoded%%  wrong  ttff50  ttff90  nofix\n");
+	for(uint8_t l = 0; l < levels; l++)
+	{
+		const MsfNoise &n = _noise ? *_noise : sweepLevels[l];
+		std::vector<uint32_t> ttff;
+		uint32_t decoded = 0, possible = 0, noFix = 0;
+		memset(&quality, 0, sizeof(quality));
+		wrong = 0;
+		for(uint32_t t = 0; t < _trials; t++)
+		{
+			// power up at a random ms within the first minute
+			rng = rng * 1103515245UL + 12345UL;
+			uint32_t powerUp = 1000 + (rng >> 8) % 60000UL;
+			possible += powerUp < 2000 ? _minutes : _minutes - 1;		// minutes received from second 1 on
+			gen.begin(_start + t * 3600, 1000);
+			gen.setNoise(n);
+			gen.setSeed(_seed + t * 7919 + l);
+			gen2.begin(_start + t * 3600, 1000);
+			gen2.setNoise(n);
+			gen2.setSeed((_seed + t * 7919 + l) ^ 0x5A5A5A5AUL);
+			startDecoder(_padding);
+			uint32_t ms;
+			uint8_t level, pin = 2;
+			bool first = true;
+			uint32_t endMs = 1000 + _minutes * 60000UL;
+			uint32_t nextQuality = powerUp + 1000;
+			if(receivers > 1) nextEdge2(ms, level, pin, true);
+			do
+			{
+				if(receivers > 1) nextEdge2(ms, level, pin, false);
+				else gen.nextEdge(ms, level);
+				if(ms < powerUp)
+				{
+					hostState().pin[pin] = level;		// the level sampling starts with
+					nextSampleMs = powerUp + sampleMs / 2;
+					continue;
+				}
+				for(; qualityMode && nextQuality < ms; nextQuality += 1000) sampleQuality(nextQuality);
+				int8_t sampledFix = sampleMs && pin == 2 ? sampleTo(ms) : 0;
+				hostEdge(ms, level, pin);
+				if(deferredMode) (pin == 2 ? msf : rx2).poll();
+				if((receivers > 1 ? reportDiversity() : sampleMs ? sampledFix : report()) > 0)
+				{
+					decoded++;
+					if(first) ttff.push_back((ms - powerUp) / 1000);
+					first = false;
+				}
+			} while(ms < endMs);
+			if(sampleMs && sampleTo(ms + 100) > 0)		// the samples that see the last edge
+			{
+				decoded++;
+				if(first) ttff.push_back((ms - powerUp) / 1000);
+				first = false;
+			}
+			if(first) noFix++;
+		}
+		std::sort(ttff.begin(), ttff.end());
+		int32_t t50 = ttff.empty() ? -1 : ttff[ttff.size() / 2];
+		int32_t t90 = ttff.empty() ? -1 : ttff[ttff.size() * 9 / 10];
+		printf("%5u %6u %7d %7u %6u %4u  %7.1f%%  %5lu  %5lds  %5lds  %5lu\n", l, n.jitterMs, n.stretchMs, n.dropout,
+			n.glitch, n.fade, 100.0 * decoded / possible, (unsigned long)wrong, (long)t50, (long)t90,
+			(unsigned long)noFix);
+		if(qualityMode) printQuality("      quality ");
+	}
+}
+
+// with -b the limits of the benchmark: ns per edge, ns per minute and the slowest minute end edge
+static double benchLimits[3] = {0, 0, 0};
+
+// benchmark: decode time only, the signal is generated beforehand, false if it is slower than the limits
+static bool bench(uint32_t _minutes, time_t _start, int8_t _padding, const MsfNoise &_noise, uint32_t _seed)
+{
+	std::vector<Edge> edges;
+	Edge e;
+	gen.begin(_start, 1000);
+	gen.setNoise(_noise);
+	gen.setSeed(_seed);
+	do
+	{
+		gen.nextEdge(e.ms, e.level);
+		edges.push_back(e);
+	} while(gen.minuteTime() < _start + (time_t)_minutes * 60);
+	uint32_t span = edges.back().ms + 1000;
+
+	quiet = true;
+	startDecoder(_padding);
+	uint32_t runs = 0;
+	double ns = 0;
+	fixes = 0;
+	while(ns < 1e9)
+	{
+		struct timespec t0, t1;
+		uint32_t offset = runs * span;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		for(size_t i = 0; i < edges.size(); i++)
+		{
+			hostEdge(edges[i].ms + offset, edges[i].level);
+			if(deferredMode) msf.poll();
+			if(msf.TimeAvailable)
+			{
+				fixes++;
+				msf.TimeAvailable = 0;
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+		runs++;
+	}
+	printf("edges=%lu runs=%lu fixes=%lu ns/edge=%.2f ns/minute=%.1f\n", (unsigned long)edges.size(), (unsigned long)runs,
+		(unsigned long)fixes, ns / (runs * edges.size()), ns / (runs * (double)_minutes));
+
+	// one more run timing each edge on its own: the edge that ends the minute (end marker,
+	// parity and time conversion) is the interrupt worst case on a board
+	double endNs = 0, endMax = 0, edgeMax = 0;
+	uint32_t ends = 0;
+	uint32_t offset = runs * span;
+	for(size_t i = 0; i < edges.size(); i++)
+	{
+		struct timespec t0, t1;
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		hostEdge(edges[i].ms + offset, edges[i].level);
+		if(deferredMode) msf.poll();
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+		double edgeNs = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+		if(edgeNs > edgeMax) edgeMax = edgeNs;
+		if(msf.TimeReceived == 1)
+		{
+			endNs += edgeNs;
+			if(edgeNs > endMax) endMax = edgeNs;
+			ends++;
+			msf.TimeReceived = 2;		// count each minute once
+		}
+	}
+	printf("minute end edges=%lu mean ns=%.1f max ns=%.0f, all edges max ns=%.0f (includes ~20ns of timer)\n",
+		(unsigned long)ends, ends ? endNs / ends : 0.0, endMax, edgeMax);
+	if(!benchLimits[0] && !benchLimits[1] && !benchLimits[2]) return true;
+	// the largest of all edges is mostly the host taking the CPU away, the minute end is the decoder
+	double measured[3] = {ns / (runs * edges.size()), ns / (runs * (double)_minutes), endMax};
+	bool fast = true;
+	for(uint8_t l = 0; l < 3; l++) fast = fast && (!benchLimits[l] || measured[l] <= benchLimits[l]);
+	printf("limits ns/edge=%.0f ns/minute=%.0f minute end max ns=%.0f %s\n", benchLimits[0], benchLimits[1], benchLimits[2],
+		fast ? "ok" : "SLOWER");
+	return fast;
+}
+
+int main(int argc, char **argv)
+{
+	std::vector<Edge> edges;
+	const char *traceName = NULL;
+	uint32_t minutes = 0, trials = 0, benchMinutes = 0, seed = 1;
+	time_t startTime = 1453203000;
+	int8_t padding = MSF_PAD_10MS;
+	MsfNoise noise;
+	bool noisy = false;
+	memset(&noise, 0, sizeof(noise));
+	noise.glitchMs = 20;
+	noise.fadeSeconds = 5;
+
+	for(int i = 1; i < argc; i++)
+	{
+		const char *arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if(!strcmp(arg, "-g") && hasValue) minutes = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-S") && hasValue) trials = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-B") && hasValue) benchMinutes = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-b") && hasValue) sscanf(argv[++i], "%lf,%lf,%lf", &benchLimits[0], &benchLimits[1], &benchLimits[2]);
+		else if(!strcmp(arg, "-t") && hasValue) startTime = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-l") && hasValue) leapSecond = atoi(argv[++i]);
+		else if(!strcmp(arg, "-d") && hasValue) utcDut = atoi(argv[++i]);
+		else if(!strcmp(arg, "-Z") && hasValue) bstStart = atoi(argv[++i]) ? 1 : 0;
+		else if(!strcmp(arg, "-p") && hasValue) { i++; padding = strcmp(argv[i], "a") ? atoi(argv[i]) : MSF_PAD_AUTO; }
+		else if(!strcmp(arg, "-j") && hasValue) { noise.jitterMs = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-s") && hasValue) { noise.stretchMs = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-o") && hasValue) { noise.dropout = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-x") && hasValue) { noise.glitch = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-X") && hasValue) noise.glitchMs = atoi(argv[++i]);
+		else if(!strcmp(arg, "-f") && hasValue) { noise.fade = atoi(argv[++i]); noisy = true; }
+		else if(!strcmp(arg, "-F") && hasValue) noise.fadeSeconds = atoi(argv[++i]);
+		else if(!strcmp(arg, "-r") && hasValue) seed = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-c") && hasValue) clockPpm = atol(argv[++i]);
+		else if(!strcmp(arg, "-u") && hasValue) jitterUs = atoi(argv[++i]);
+		else if(!strcmp(arg, "-G") && hasValue) glitchMs = atoi(argv[++i]);
+		else if(!strcmp(arg, "-D")) deferredMode = true;
+		else if(!strcmp(arg, "-V")) voteMode = true;
+		else if(!strcmp(arg, "-M")) repairMode = true;
+		else if(!strcmp(arg, "-T")) trackMode = true;
+		else if(!strcmp(arg, "-Q")) qualityMode = true;
+		else if(!strcmp(arg, "-R") && hasValue) receivers = atoi(argv[++i]) > 1 ? 2 : 1;
+		else if(!strcmp(arg, "-H") && hasValue)
+		{
+			char *end;
+			holdAfter = strtoul(argv[++i], &end, 10);
+			if(*end == ':') holdSeconds = atoi(end + 1);
+		}
+		else if(!strcmp(arg, "-L") && hasValue) lateSeconds = atoi(argv[++i]);
+		else if(!strcmp(arg, "-K") && hasValue) sampleMs = atoi(argv[++i]);
+		else if(!strcmp(arg, "-P") && hasValue) dutyBudget = strtoul(argv[++i], NULL, 10);
+		else if(!strcmp(arg, "-w")) writeTrace = true;
+		else if(!strcmp(arg, "-E")) dumpEdges = quiet = true;
+		else if(!strcmp(arg, "-C")) callbacks = true;
+		else if(!strcmp(arg, "-U")) utcMode = true;
+		else if(!strcmp(arg, "-q")) quiet = true;
+		else traceName = arg;
+	}
+
+	if(benchMinutes) return bench(benchMinutes, startTime, padding, noise, seed) ? 0 : 3;
+	if(trials)
+	{
+		sweep(trials, minutes ? minutes : 30, startTime, padding, noisy ? &noise : NULL, seed);
+		return 0;
+	}
+	if(!minutes && !traceName)
+	{
+		fprintf(stderr, "usage: msf_replay <trace file> | -g <minutes> | -S <trials> [options], see the source\n");
+		return 1;
+	}
+	if(!minutes && !readTrace(traceName, edges))
+	{
+		fprintf(stderr, "%s: cannot be read or is a damaged recording\n", traceName);
+		return 1;
+	}
+	if(!startDecoder(padding))
+	{
+		fprintf(stderr, "begin() failed\n");
+		return 1;
+	}
+
+	if(dumpEdges) msf.record(true);
+	if(callbacks)
+	{
+		msf.onMinute(minuteEvent);
+		msf.onSecond(secondEvent);
+		msf.onDecodeError(errorEvent);
+	}
+
+	struct timespec t0, t1;
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+	if(minutes)
+	{
+		// the edges are generated as they are decoded so long runs need no memory
+		generating = true;
+		gen.begin(startTime, 1000);
+		gen.setNoise(noise);
+		gen.setSeed(seed);
+		gen.setDut1(utcDut);
+		uint32_t ms, minuteMs = 1000, minute = 0, leapMinute = 0;
+		uint8_t level;
+		uint32_t nextSample = 1000 + 600000UL, nextHold = 1000, onMs = 0;
+		holdStart = startTime - startTime % 60;
+		utcStart = holdStart - (bstStart > 0 ? 3600 : 0);
+		if(bstStart >= 0)
+		{
+			// the BST change is at 01:00 UTC, BstSoon is sent for the 61 minutes before
+			bstChange = utcStart - utcStart % 86400 + 3600;
+			if(bstChange <= utcStart) bstChange += 86400;
+			gen.setBst(bstStart, false);
+			gen.setBstChange(bstChange);
+		}
+		if(leapSecond)
+		{
+			// a leap second is only believed at the end of a UTC month, the first one in the run
+			uint8_t rtc[7];
+			MsfTimeLib::fromTimeT(utcStart + 59, rtc);
+			rtc[MSF_SECOND] = rtc[MSF_MINUTE] = rtc[MSF_HOUR] = 0;
+			rtc[MSF_DATE] = 1;
+			if(rtc[MSF_MONTH] == 0x12) rtc[MSF_YEAR] = MsfTimeLib::decToBcd(MsfTimeLib::bcdToDec(rtc[MSF_YEAR]) + 1);
+			rtc[MSF_MONTH] = rtc[MSF_MONTH] == 0x12 ? 1 : MsfTimeLib::decToBcd(MsfTimeLib::bcdToDec(rtc[MSF_MONTH]) + 1);
+			leapEnd = MsfTimeLib::toTimeT(rtc);
+			leapMinute = (leapEnd - 60 - utcStart) / 60;
+			if(holdStart + (time_t)leapMinute * 60 >= startTime + (time_t)minutes * 60) leapEnd = leapMinute = 0;
+			if(!leapMinute) gen.setLeapSecond(leapSecond);
+		}
+		bool lost = false, sampling = holdAfter || dutyBudget || qualityMode || utcMode;
+		if(dutyBudget) duty.begin(msf, dutyBudget);
+		// run until the start of the minute after the last one so it is delivered
+		do
+		{
+			gen.nextEdge(ms, level);
+			// the minutes are counted as a BST change moves the time sent by an hour
+			if(gen.minuteStartMs() != minuteMs)
+			{
+				minuteMs = gen.minuteStartMs();
+				minute++;
+			}
+			if(leapMinute && minute + 1 == leapMinute)
+			{
+				gen.setLeapSecond(leapSecond);	// for the next minute
+				leapMinute = 0;
+			}
+			while(ms > nextSample + 700)
+			{
+				samplePll(nextSample);
+				nextSample += 1000;
+			}
+			while(sampling && ms > nextHold + 700)
+			{
+				sampleHold(nextHold, lost);
+				if(utcMode) sampleUtc(nextHold);
+				if(qualityMode) sampleQuality(nextHold + 700);
+				if(dutyBudget)
+				{
+					// loop() runs once a second, the receiver has no output while off and settling
+					bool wasOn = !lost;
+					duty.update();
+					lost = digitalRead(DUTY_PON_PIN) == HIGH;
+					if(!lost && !wasOn) onMs = nextHold + 700;
+				}
+				nextHold += 1000;
+			}
+			// with -H the receiver output stops (no edges) after holdAfter minutes and holdSeconds, after
+			// the carrier OFF edge that starts the second so the minute before is delivered
+			if(holdAfter)
+			{
+				uint32_t at = holdSeconds * 1000UL + 250;
+				lost = minute > holdAfter || (minute == holdAfter && (int32_t)(ms - minuteMs) >= (int32_t)at);
+				if(lost && !lossMs) lossMs = minute == holdAfter ? minuteMs + at : ms;
+			}
+			if(lateSeconds && lateMinute() && ms - gen.minuteStartMs() < lateSeconds * 1000UL) continue;
+			if(!lost && (!onMs || ms >= onMs + DUTY_SETTLE_MS)) play(ms, level);
+		} while(holdStart + (time_t)minute * 60 < startTime + (time_t)minutes * 60);
+		if(sampleMs) sampleTo(ms + 100);	// the samples that see the last edge
+		if(holdAfter) minutes = holdAfter < minutes ? holdAfter : minutes;
+	}
+	for(size_t i = 0; i < edges.size(); i++) play(edges[i].ms, edges[i].level);
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	if(writeTrace) return 0;
+	if(dumpEdges)
+	{
+		StdoutPrint out;
+		msf.dumpRecord(out);
+		return 0;
+	}
+	double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+
+	printf("edges=%lu fixes=%lu failures=%lu", (unsigned long)numEdges, (unsigned long)fixes, (unsigned long)failures);
+	if(minutes) printf(" expected=%lu wrong=%lu", (unsigned long)minutes, (unsigned long)wrong);
+	printf(" ns/edge=%.1f\n", numEdges ? ns / numEdges : 0.0);
+	if(minutes) printf("pll seconds=%lu rms=%.1fus max=%.0fus uncertainty=%.1fus nowmax=%.0fus outside=%lu\n", (unsigned long)pll.samples,
+		pll.samples ? sqrt(pll.sumSquares / pll.samples) : 0.0, pll.maxError,
+		pll.samples ? pll.sumUncertainty / pll.samples : 0.0, pll.maxNowError, (unsigned long)pll.outside);
+	if(minutes && padding == MSF_PAD_AUTO) printf("auto pulse offset=%dms\n", msf.pulseOffset());
+	if(holdAfter || dutyBudget) printf("holdover signal=%.0fms lost=%.0fms drift=%ld+/-%luppb uncertainty=%luus outside=%lu\n",
+		hold.maxSignal, hold.maxLost, (long)msf.driftPpb(), (unsigned long)msf.driftUncertaintyPpb(),
+		(unsigned long)hold.uncertainty, (unsigned long)hold.outside);
+	if(dutyBudget) printf("duty on=%lus (%.1f%%) wakeups=%u fixes=%u failures=%u on/fix=%.0fs settle=%us attempts=%u\n",
+		(unsigned long)duty.OnSeconds, 100.0 * duty.OnSeconds / (minutes * 60.0), duty.Wakeups, duty.Fixes,
+		duty.Failures, duty.Fixes ? (double)duty.OnSeconds / duty.Fixes : 0.0, duty.LastSettleSeconds, duty.LastAttempts);
+	if(trackMode) printf("track minutes=%u\n", msf.TrackedMinutes);
+	if(lateSeconds) printf("late fixes=%lu start max=%.0fus misplaced=%lu\n", (unsigned long)lateFixes, lateMaxError,
+		(unsigned long)lateMisplaced);
+	if(qualityMode) printQuality("quality ");
+	if(utcMode) printf("utc seconds=%lu utc=%.0fms ut1=%.0fms local=%.0fms offset=%lu change=%lu outside=%lu\n",
+		(unsigned long)utc.seconds, utc.maxUtc, utc.maxUt1, utc.maxLocal, (unsigned long)utc.offset,
+		(unsigned long)utc.change, (unsigned long)utc.outside);
+	if(callbacks) printf("callbacks minutes=%lu seconds=%lu unknown=%lu misnumbered=%lu errors=%lu\n", (unsigned long)calls.minutes,
+		(unsigned long)calls.seconds, (unsigned long)calls.unknown, (unsigned long)calls.misnumbered, (unsigned long)calls.errors);
+#if MSF_STATS
+	MsfStats stats;
+	msf.getStats(stats);
+	printf("stats isr=%u/%.1f/%uus minute=%u/%.1f/%uus short=%u 400ms=%u bonly=%u parity=%u/%u/%u/%u minutes=%u/%u/%u\n",
+		stats.isr.count ? stats.isr.min : 0, stats.isr.count ? (double)stats.isr.sum / stats.isr.count : 0.0, stats.isr.max,
+		stats.minute.count ? stats.minute.min : 0, stats.minute.count ? (double)stats.minute.sum / stats.minute.count : 0.0,
+		stats.minute.max, stats.shortPulses, stats.pulses400, stats.bitBonly, stats.parityFails[0], stats.parityFails[1],
+		stats.parityFails[2], stats.parityFails[3], stats.minutesStarted, stats.minutesEnded, stats.minutesDecoded);
+	printf("pulses");
+	for(uint8_t b = 0; b < MSF_STATS_BINS; b++) printf(" %u", stats.pulses[b]);
+	printf("\n");
+#endif
+	if(minutes && !noisy && !dutyBudget && (fixes != minutes || wrong)) return 2;
+	if(minutes && !noisy && pll.outside) return 4;
+	if(minutes && !noisy && lateMisplaced) return 5;
+	return (minutes && utcMode && !noisy && (utc.offset || utc.change || utc.outside)) ? 6 : 0;
+}
@@ -0,0 +1,84 @@
+/************************************************************************************
+ Edge traces for the host programs (msf_replay.cpp, msf_batch.cpp)
+
+ Reads a trace file, one "<time in ms> <pin level 0|1>" edge per line ('#' starts a comment),
+ or a dumpRecord() recording (the MSFREC header, see notes.txt) into a list of edges.
+
+ You are free to use this library as you see fit as long as this text remains with it!
+ Copyright 2014, 2015 & 2016 Phil Morris
+**************************************************************************************/
+
+#ifndef msf_trace_h
+#define msf_trace_h
+
+#include <stdio.h>
+#include <vector>
+#include <Arduino.h>
+
+struct Edge
+{
+	uint32_t ms;
+	uint8_t level;
+};
+
+// the edges of a dumpRecord() recording, the first line (the header) has been read already.
+// false if it is damaged (a value longer than 32 bits)
+inline bool readRecord(FILE *_f, const char *_header, std::vector<Edge> &_edges)
+{
+	unsigned version = 0, carrier = 1;
+	unsigned long unit = 0, bytes = 0;
+	sscanf(_header, "MSFREC %u %lu %u %lu", &version, &unit, &carrier, &bytes);
+	uint64_t us = 1000000ULL;				// the first edge a second in
+	uint32_t value = 0;
+	uint8_t shift = 0;
+	char line[128];
+	while(fgets(line, sizeof(line), _f) && strncmp(line, "END", 3))
+	{
+		for(char *c = line; c[0] && c[1]; c += 2)
+		{
+			char hex[3] = {c[0], c[1], 0};
+			char *end;
+			uint8_t b = strtoul(hex, &end, 16);
+			if(*end) break;
+			if(shift > 28) return false;
+			value |= (uint32_t)(b & 0x7F) << shift;
+			shift += 7;
+			if(b & 0x80) continue;
+			us += (uint64_t)(value >> 1) * unit;
+			Edge e;
+			e.ms = us / 1000;
+			e.level = (value & 1) == carrier ? HIGH : LOW;	// as an MSF_PULSE_HIGH receiver
+			_edges.push_back(e);
+			value = shift = 0;
+		}
+	}
+	return true;
+}
+
+inline bool readTrace(const char *_name, std::vector<Edge> &_edges)
+{
+	FILE *f = strcmp(_name, "-") ? fopen(_name, "r") : stdin;
+	if(!f) return false;
+	char line[128];
+	bool ok = true;
+	while(fgets(line, sizeof(line), f))
+	{
+		unsigned long ms;
+		unsigned level;
+		if(!strncmp(line, "MSFREC", 6))
+		{
+			ok = readRecord(f, line, _edges);
+			break;
+		}
+		if(line[0] == '#') continue;
+		if(sscanf(line, "%lu %u", &ms, &level) != 2) continue;
+		Edge e;
+		e.ms = ms;
+		e.level = level ? HIGH : LOW;
+		_edges.push_back(e);
+	}
+	if(f != stdin) fclose(f);
+	return ok;
+}
+
+#endif
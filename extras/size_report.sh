@@ -0,0 +1,62 @@
+#!/bin/sh
+#####################################################################################
+# MsfTimeLib size report
+#
+# Builds MsfTimeLib.cpp once for each MSF_FEATURES setting below and prints the
+# flash (code and constant tables) and the RAM of one decoder (the global msf).
+# Run it from the library folder:
+#
+#	extras/size_report.sh					avr-g++ for an ATmega328P, g++ if there is none
+#	CXX=g++ extras/size_report.sh			the host build
+#	MCU=atmega2560 extras/size_report.sh	another AVR
+#
+# The Arduino core is replaced by extras/host/Arduino.h so only the library is counted.
+# It fails (exit 1) when the decoder with no features is more than SLACK bytes larger
+# than the original library (BASELINE, the RAM of msf in version 2.7.0), some part
+# is then not behind MSF_FEATURES.
+#
+# You are free to use this library as you see fit as long as this text remains with it!
+# Copyright 2014, 2015 & 2016 Phil Morris
+#####################################################################################
+
+CXX=${CXX:-avr-g++}
+MCU=${MCU:-atmega328p}
+if ! command -v "$CXX" >/dev/null 2>&1; then CXX=g++; fi
+case "$CXX" in
+	avr-*)	FLAGS="-mmcu=$MCU -Os"; BASELINE=${BASELINE:-62} ;;
+	*)		FLAGS="-Os"; BASELINE=${BASELINE:-80} ;;
+esac
+SLACK=${SLACK:-8}
+TOOLS=${CXX%g++}
+OBJ=${TMPDIR:-/tmp}/msf_size_$$.o
+
+# name and MSF_FEATURES value of each build: everything, nothing, and everything but one
+# (-fix leaves out the holdover clock as well, it needs the fix)
+CONFIGS="all:0x7FFFF none:0x00 -led:0x7FFFE -pon:0x7FFFD -dut:0x7FFFB -bst:0x7FFF7 -hold:0x7FFEF
+	-freemem:0x7FFDF -defer:0x7FFBF -pll:0x7FF7F -fix:0x7FEEF -events:0x7FDFF -glitch:0x7FBFF
+	-clock:0x7F7FF -vote:0x7EFFF -auto:0x7DFFF -sampled:0x7BFFF -track:0x77FFF -quality:0x6FFFF
+	-repair:0x5FFFF -record:0x3FFFF"
+
+status=0
+echo "$CXX $FLAGS"
+printf "%-10s %-7s %7s %7s\n" features value flash ram
+for config in $CONFIGS; do
+	name=${config%%:*}
+	value=${config#*:}
+	if ! $CXX $FLAGS -std=gnu++11 -ffunction-sections -fdata-sections -DMSF_FEATURES=$value \
+		-Iextras/host -I. -c MsfTimeLib.cpp -o "$OBJ"; then
+		echo "$name: build failed"
+		status=1
+		continue
+	fi
+	flash=$(${TOOLS}size -A "$OBJ" | awk '$1 ~ /^\.(text|rodata|progmem|data)/ { sum += $2 } END { print sum }')
+	ram=$(${TOOLS}nm -S --defined-only "$OBJ" | awk '$4 == "msf" { print $2 }')
+	ram=$((0x${ram:-0}))
+	printf "%-10s %-7s %7s %7s\n" "$name" "$value" "$flash" "$ram"
+	if [ "$name" = none ] && [ "$ram" -gt $((BASELINE + SLACK)) ]; then
+		echo "none: $ram bytes of RAM, more than $SLACK over the $BASELINE of the original library"
+		status=1
+	fi
+done
+rm -f "$OBJ"
+exit $status
@@ -0,0 +1,49 @@
+#!/bin/sh
+#####################################################################################
+# MsfTimeLib speed check
+#
+# For a change meant to make the decoder faster: builds the differential fuzzer and
+# the replay tool, checks the decoder still decodes as the frozen reference does
+# (extras/host/reference) and that the benchmark is within the limits. Run it from
+# the library folder:
+#
+#	extras/speed_check.sh						fuzz 20000 cases, benchmark 1000 minutes
+#	CASES=200000 extras/speed_check.sh			more fuzzing
+#	LIMITS=40,5000,600 extras/speed_check.sh	ns/edge, ns/minute, slowest minute end edge
+#
+# The default limits are about 1.5 times (2 times for the minute end) what a 2020s PC
+# measures, set LIMITS from a run of "msf_replay -B 1000" on a slower one. A host can
+# take the CPU away during a timed edge so the benchmark is tried up to 3 times.
+# Returns 0 if both pass.
+#
+# You are free to use this library as you see fit as long as this text remains with it!
+# Copyright 2014, 2015 & 2016 Phil Morris
+#####################################################################################
+
+CXX=${CXX:-g++}
+CASES=${CASES:-20000}
+LIMITS=${LIMITS:-55,6600,900}
+DIR=${TMPDIR:-/tmp}
+FUZZ=$DIR/msf_fuzz_$$
+REPLAY=$DIR/msf_replay_$$
+FLAGS="-O2 -std=gnu++11 -Iextras/host -I."
+
+if ! $CXX $FLAGS extras/host/msf_fuzz.cpp extras/host/msf_reference.cpp MsfTimeLib.cpp MsfSignalGen.cpp -o "$FUZZ" ||
+	! $CXX $FLAGS extras/host/msf_replay.cpp MsfTimeLib.cpp MsfSignalGen.cpp MsfDiversity.cpp MsfDutyCycle.cpp -o "$REPLAY"; then
+	echo "build failed"
+	rm -f "$FUZZ" "$REPLAY"
+	exit 1
+fi
+
+result=1
+if "$FUZZ" -n "$CASES"; then
+	for try in 1 2 3; do
+		if "$REPLAY" -B 1000 -b "$LIMITS"; then
+			result=0
+			break
+		fi
+	done
+fi
+rm -f "$FUZZ" "$REPLAY"
+if [ $result -eq 0 ]; then echo "speed check passed"; else echo "speed check FAILED"; fi
+exit $result